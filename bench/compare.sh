@@ -0,0 +1,40 @@
+#!/bin/sh
+# Builds libsolc at each of the given revisions and runs one solcbench
+# benchmark against every build, so that before and after figures can be
+# reproduced side by side:
+#
+#   bench/compare.sh numbers 3872a89 e3bd42e
+#   bench/compare.sh emit 1bab771 32809aa
+#
+# CMAKE_ARGS is passed to each configure, for instance to point
+# CMAKE_INSTALL_PREFIX at a libsol install; BUILD_TYPE defaults to Release.
+
+set -e
+if [ $# -lt 2 ]; then
+    echo "usage:  bench/compare.sh benchmark revision..." >&2
+    exit 1
+fi
+benchmark=$1
+shift
+root=$(git rev-parse --show-toplevel)
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+for revision in "$@"; do
+    tree="$work/$revision"
+    mkdir -p "$tree"
+    git -C "$root" archive "$revision" | tar -x -C "$tree"
+    # build output is only shown if the build fails
+    if ! { cmake -S "$tree" -B "$tree/build" -DCMAKE_BUILD_TYPE="${BUILD_TYPE:-Release}" $CMAKE_ARGS \
+            && cmake --build "$tree/build" --target libsolc; } >"$tree/build.log" 2>&1; then
+        cat "$tree/build.log" >&2
+        exit 1
+    fi
+    # the bench source comes from the current tree, built against the old library
+    prefix=$(sed -n 's/^CMAKE_INSTALL_PREFIX:PATH=//p' "$tree/build/CMakeCache.txt")
+    libsol=$(sed -n 's/^libsol:FILEPATH=//p' "$tree/build/CMakeCache.txt")
+    ${CC:-cc} -std=c99 -O2 -D_POSIX_C_SOURCE=200809L -I"$tree" -I"$prefix/include" \
+        -o "$tree/solcbench" "$root/bench/solcbench.c" -L"$tree/build" -lsolc "$libsol" -lm
+    printf '%s  ' "$revision"
+    LD_LIBRARY_PATH="$tree/build:$(dirname "$libsol")${LD_LIBRARY_PATH:+:$LD_LIBRARY_PATH}" "$tree/solcbench" "$benchmark"
+done
@@ -0,0 +1,173 @@
+/* 
+ * File:   solcbench.c
+ *
+ * Created on October 17, 2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <sol/runtime.h>
+#include "solc.h"
+
+/*
+ * Micro-benchmarks for libsolc. Only the public context API is used, so the
+ * same source builds against older revisions of the library; see
+ * compare.sh for running it before and after a change.
+ *
+ *   solcbench numbers [count]   parses count number literals (default 600k)
+ *   solcbench emit [megabytes]  emits a program parsed from about that much
+ *                               source (default 11) and reports MB/s
+ */
+
+#define BENCH_DEFAULT_LITERALS 600000
+#define BENCH_LITERALS_PER_FORM 100
+#define BENCH_ROUNDS 5
+#define BENCH_DEFAULT_MEGABYTES 11
+#define BENCH_EMIT_SECONDS 2.0
+
+static double now(void);
+static char* make_numbers(size_t count, size_t* length);
+static int bench_numbers(size_t count);
+static char* make_program(size_t megabytes, size_t* length);
+static int bench_emit(size_t megabytes);
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage:  solcbench numbers [count]\n        solcbench emit [megabytes]\n");
+        return EXIT_FAILURE;
+    }
+    sol_runtime_init();
+    int ret;
+    if (!strcmp(argv[1], "numbers")) {
+        ret = bench_numbers(argc > 2 ? strtoul(argv[2], NULL, 10) : BENCH_DEFAULT_LITERALS);
+    } else if (!strcmp(argv[1], "emit")) {
+        ret = bench_emit(argc > 2 ? strtoul(argv[2], NULL, 10) : BENCH_DEFAULT_MEGABYTES);
+    } else {
+        fprintf(stderr, "Unknown benchmark '%s'.\n", argv[1]);
+        ret = EXIT_FAILURE;
+    }
+    sol_runtime_destroy();
+    return ret;
+}
+
+static double now(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+static char* make_numbers(size_t count, size_t* length) {
+    // a fixed mix of integers, decimals and exponents, a third of each, in
+    // list literals so that nothing but the numbers needs evaluating
+    size_t capacity = count * 24 + count / BENCH_LITERALS_PER_FORM * 4 + 16;
+    char* source = malloc(capacity);
+    if (source == NULL) return NULL;
+    char* p = source;
+    unsigned long seed = 1;
+    for (size_t i = 0; i < count; i++) {
+        if (i % BENCH_LITERALS_PER_FORM == 0) p += sprintf(p, i ? ")\n(" : "(");
+        seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+        unsigned long digits = (seed >> 33) % 100000000;
+        switch (i % 3) {
+            case 0:
+                p += sprintf(p, "%lu ", digits);
+                break;
+            case 1:
+                p += sprintf(p, "%lu.%03lu ", digits / 1000, digits % 1000);
+                break;
+            default:
+                p += sprintf(p, "%lu.%lue%d ", digits % 10, digits / 10, (int) (seed >> 20) % 40 - 20);
+                break;
+        }
+    }
+    p += sprintf(p, ")\n");
+    *length = p - source;
+    return source;
+}
+
+static int bench_numbers(size_t count) {
+    size_t length;
+    char* source = make_numbers(count, &length);
+    if (source == NULL) {
+        fprintf(stderr, "Out of memory.\n");
+        return EXIT_FAILURE;
+    }
+    
+    // the best of several rounds, each on a fresh context
+    double best = 0;
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        solc_context* ctx = solc_context_create();
+        double start = now();
+        SolList program = solc_parse_n_ctx(ctx, source, length);
+        double seconds = now() - start;
+        if (program == NULL) {
+            fprintf(stderr, "The generated source did not parse.\n");
+            solc_context_destroy(ctx);
+            free(source);
+            return EXIT_FAILURE;
+        }
+        sol_obj_release((SolObject) program);
+        solc_context_destroy(ctx);
+        if (round == 0 || seconds < best) best = seconds;
+    }
+    printf("numbers: %zu literals in %.3f s, %.2fM literals/s\n", count, best, count / best / 1e6);
+    free(source);
+    return EXIT_SUCCESS;
+}
+
+static char* make_program(size_t megabytes, size_t* length) {
+    // statements with nested lists, tokens, strings and numbers, repeated
+    // until the source reaches the requested size
+    static const char form[] =
+        "[set counter (+ counter 1)]\n"
+        "[print \"iteration\" counter (list 1.5 2 \"three\" (four five) -6.25e3)]\n"
+        "[if (> counter 100) ^[print \"done\"] ^[set total (* total 1.0001)]]\n";
+    size_t target = megabytes * 1024 * 1024;
+    size_t copies = target / (sizeof(form) - 1) + 1;
+    char* source = malloc(copies * (sizeof(form) - 1) + 1);
+    if (source == NULL) return NULL;
+    for (size_t i = 0; i < copies; i++) {
+        memcpy(source + i * (sizeof(form) - 1), form, sizeof(form) - 1);
+    }
+    *length = copies * (sizeof(form) - 1);
+    source[*length] = '\0';
+    return source;
+}
+
+static int bench_emit(size_t megabytes) {
+    size_t length;
+    char* source = make_program(megabytes, &length);
+    solc_context* ctx = solc_context_create();
+    SolList program = source ? solc_parse_n_ctx(ctx, source, length) : NULL;
+    free(source);
+    if (program == NULL) {
+        fprintf(stderr, "The generated program could not be parsed.\n");
+        solc_context_destroy(ctx);
+        return EXIT_FAILURE;
+    }
+    
+    // emit repeatedly for a fixed time on the same context
+    size_t rounds = 0;
+    double total = 0, start = now(), elapsed;
+    do {
+        off_t size;
+        unsigned char* image = solc_emit_ctx(ctx, program, &size);
+        if (image == NULL) {
+            fprintf(stderr, "The program could not be emitted.\n");
+            sol_obj_release((SolObject) program);
+            solc_context_destroy(ctx);
+            return EXIT_FAILURE;
+        }
+        free(image);
+        total += size;
+        rounds++;
+    } while ((elapsed = now() - start) < BENCH_EMIT_SECONDS);
+    printf("emit: %.1f MB image, %zu rounds in %.3f s, %.1f MB/s\n", total / rounds / (1024 * 1024), rounds,
+            elapsed, total / elapsed / (1024 * 1024));
+    sol_obj_release((SolObject) program);
+    solc_context_destroy(ctx);
+    return EXIT_SUCCESS;
+}
@@ -9,15 +9,99 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
 
 #include <sol/runtime.h>
 #include "solc.h"
 #include "solgen.h"
+#include "solcelf.h"
+#include "solccache.h"
 #include "linenoise.h"
 
+// units are compiled exactly and without optimization, so that linking
+// them gives the program whatever options it is compiled with
+#define SOLC_UNIT_FORMAT (SOLC_FORMAT_NUMBERS | SOLC_FORMAT_VARINT | SOLC_FORMAT_SHARE)
+
+// destinations the compiled binary is copied to as it is emitted
+typedef struct solc_outputs {
+    FILE* bin;
+    solc_generator* gen;
+    solc_elf_writer* elf;
+    solc_cache_entry* cache;
+} solc_outputs;
+
+// how each program is compiled and which files are written for it
+typedef struct solc_options {
+    unsigned int format;
+    bool optimize;
+    char** disabled_passes;
+    size_t disabled_count;
+    bool flag_b, flag_c, flag_s, flag_x, time_passes;
+    solc_elf_machine machine;
+    solc_cache* cache;
+    // where the units of a linked program are kept; the cache above if
+    // there is one
+    solc_cache* units;
+    bool cache_stats;
+} solc_options;
+
+// what a program is written from: a parsed program, a cached binary, or
+// the compiled units of filenames linked together; the binary emitted for
+// a parsed program is also stored in the cache entry, if there is one
+typedef struct solc_input {
+    SolList program;
+    const unsigned char* image;
+    size_t image_size;
+    char** filenames;
+    size_t count;
+    unsigned char** units;
+    size_t* unit_sizes;
+    solc_cache_entry* store;
+} solc_input;
+
+// files shared out to worker threads, each compiling with its own context;
+// units is set when the files are units of one program, and receives the
+// binary compiled for each, and otherwise each file is written to the
+// name in outputs, which is NULL if another file of the batch has it
+typedef struct solc_batch {
+    char** filenames;
+    char** outputs;
+    size_t count;
+    size_t next;
+    size_t done;
+    size_t failed;
+    unsigned char** units;
+    size_t* unit_sizes;
+    const solc_options* options;
+    pthread_mutex_t lock;
+} solc_batch;
+
 void solc_repl_activate(void);
+void solc_print_error(solc_context* ctx, char* filename);
+void solc_print_pass_times(solc_context* ctx);
+bool solc_write_outputs(const unsigned char* bytes, size_t size, void* data);
+void solc_apply_options(solc_context* ctx, const solc_options* options);
+bool solc_compile_file(solc_context* ctx, char* filename, char* output, const solc_options* options);
+bool solc_compile_cached(solc_context* ctx, char* filename, char* output, const solc_options* options);
+bool solc_execute_file(solc_context* ctx, char* filename, const solc_options* options);
+bool solc_write_program(solc_context* ctx, const solc_input* input, char* output, const solc_options* options);
+void solc_close_cache(const solc_options* options);
+bool solc_compile_batch(char** filenames, size_t count, unsigned char** units, size_t* unit_sizes, long jobs,
+        const solc_options* options);
+void* solc_batch_worker(void* data);
+bool solc_batch_outputs(char** filenames, size_t count, char** outputs);
+int compare_outputs(const void* a, const void* b);
+int compare_output_names(char* a, char* b);
+bool solc_check_units(char** filenames, size_t count, char* output, const solc_options* options);
+bool solc_compile_unit(solc_context* ctx, char* filename, solc_cache* cache, unsigned char** image, size_t* size);
+bool solc_link_units(solc_context* ctx, const solc_input* input, solc_outputs* outputs);
 
+unsigned char* file_read(FILE* file, size_t* size);
+unsigned char* file_read_path(char* filename, size_t* size);
 char* file_strip_path(char* file);
+char* file_find_extension(char* file);
 char* file_get_name(char* file);
 char* file_modify_extension(char* file, char* ext);
 
@@ -26,28 +110,75 @@ char* file_modify_extension(char* file, char* ext);
  */
 int main(int argc, char** argv) {
     // parse command-line flags
-    char* filename = NULL;
-    bool flag_b = false, flag_c = false, flag_e = false, flag_i = false;
+    char* filenames[argc];
+    size_t file_count = 0;
+    char* output_name = NULL;
+    char* disabled_passes[argc];
+    size_t disabled_count = 0;
+    long jobs = 1;
+    bool flag_a = false, flag_b = false, flag_c = false, flag_d = false, flag_e = false, flag_i = false, flag_2 = false;
+    bool flag_O = false, flag_s = false, flag_x = false, time_passes = false, cache_stats = false;
+    solc_elf_machine machine = SOLC_ELF_HOST;
     for (int i = 1; i < argc; i++) {
         char* arg = argv[i];
         if (*arg == '-') {
-            if (arg[1] == '-') {
+            if (!strcmp(arg, "--time-passes")) {
+                time_passes = true;
+            } else if (!strcmp(arg, "--cache-stats")) {
+                cache_stats = true;
+            } else if (!strcmp(arg, "--target=x86_64")) {
+                machine = SOLC_ELF_X86_64;
+            } else if (!strcmp(arg, "--target=aarch64")) {
+                machine = SOLC_ELF_AARCH64;
+            } else if (!strncmp(arg, "--disable-pass=", 15)) {
+                disabled_passes[disabled_count++] = arg + 15;
+            } else if (arg[1] == '-') {
                 fprintf(stderr, "Unrecognized flag %s.\n", arg);
             } else {
                 while (*++arg != '\0') {
                     switch (*arg) {
+                        case '2':
+                            flag_2 = true;
+                            break;
+                        case 'a':
+                            flag_a = true;
+                            break;
                         case 'b':
                             flag_b = true;
                             break;
                         case 'c':
                             flag_c = true;
                             break;
+                        case 'd':
+                            flag_d = true;
+                            break;
                         case 'e':
                             flag_e = true;
                             break;
                         case 'i':
                             flag_i = true;
                             break;
+                        case 'j':
+                            // the count may follow directly, as in -j8
+                            if (arg[1] != '\0') {
+                                jobs = strtol(arg + 1, NULL, 10);
+                                arg += strlen(arg) - 1;
+                            } else if (i + 1 < argc) {
+                                jobs = strtol(argv[++i], NULL, 10);
+                            }
+                            break;
+                        case 'o':
+                            if (i + 1 < argc) output_name = argv[++i];
+                            break;
+                        case 'O':
+                            flag_O = true;
+                            break;
+                        case 's':
+                            flag_s = true;
+                            break;
+                        case 'x':
+                            flag_x = true;
+                            break;
                         default:
                             fprintf(stderr, "Unrecognized flag -%c.\n", *arg);
                             break;
@@ -55,9 +186,10 @@ int main(int argc, char** argv) {
                 }
             }
         } else {
-            filename = arg;
+            filenames[file_count++] = arg;
         }
     }
+    char* filename = file_count ? filenames[0] : NULL;
     
     // handle REPL interactive mode
     if (flag_i) {
@@ -67,62 +199,166 @@ int main(int argc, char** argv) {
     
     // handle invalid input
     if (argc == 0 || !filename) {
-        printf("usage:  solc [-i] [-b|-c|-e] filename\n");
+        printf("usage:  solc [-i] [-2] [-O] [--disable-pass=name] [--time-passes] [--cache-stats] [-s|-x [--target=x86_64|aarch64]] [-a|-b|-c|-d|-e] [-j jobs] [-o output] filename...\n");
+        return EXIT_FAILURE;
+    }
+    if ((int) flag_a + (int) flag_b + (int) flag_c + (int) flag_d + (int) flag_e > 1) {
+        fprintf(stderr, "Invalid flag combination: -a, -c, -b, -d, -e are exclusive.\n");
         return EXIT_FAILURE;
     }
-    if ((int) flag_b + (int) flag_c + (int) flag_e > 1) {
-        fprintf(stderr, "Invalid flag combination: -c, -b, -e are exclusive.\n");
+    if (file_count > 1 && (flag_a || flag_d || flag_e)) {
+        fprintf(stderr, "Invalid flag combination: -a, -d, -e take a single file.\n");
         return EXIT_FAILURE;
     }
+    char* output = output_name ? output_name : file_strip_path(filename);
+    
+    // -j 0 uses every core
+    if (jobs <= 0) jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    if (jobs <= 0) jobs = 1;
+    
+    // the runtime only loads version 1 images, so -e ignores -2
+    solc_options options = {
+        .format = flag_2 && !flag_e ? SOLC_FORMAT_ALL : 0,
+        .optimize = flag_O,
+        .disabled_passes = disabled_passes,
+        .disabled_count = disabled_count,
+        .flag_b = flag_b, .flag_c = flag_c, .flag_s = flag_s, .flag_x = flag_x,
+        .time_passes = time_passes,
+        .machine = machine,
+        .cache_stats = cache_stats
+    };
     
     // handle sol runtime information
     sol_runtime_init();
     
-    // begin compilation
+    solc_context* ctx = solc_context_create();
+    for (size_t i = 0; i < disabled_count; i++) {
+        if (!solc_context_disable_pass(ctx, disabled_passes[i])) {
+            fprintf(stderr, "Unknown optimization pass '%s'.\n", disabled_passes[i]);
+        }
+    }
+    solc_apply_options(ctx, &options);
+    
+    // binaries are cached when SOLC_CACHE_DIR names a directory
+    solc_cache cache;
+    if (!flag_a && !flag_d && solc_cache_open(&cache)) options.cache = &cache;
+    
+    // several files without an output name are separate programs; with one
+    // they are units, compiled in memory and linked together, and kept by
+    // content in the cache or else in the output's .solunits directory so
+    // that unchanged ones need not be compiled again
+    if (file_count > 1) {
+        unsigned char* units[file_count];
+        size_t unit_sizes[file_count];
+        solc_cache unit_cache;
+        bool success = true;
+        if (output_name) {
+            memset(units, 0, sizeof(units));
+            success = solc_check_units(filenames, file_count, output, &options);
+            char* units_dir = file_modify_extension(output, "solunits");
+            if (options.cache) {
+                options.units = options.cache;
+            } else if (success && solc_cache_open_dir(&unit_cache, units_dir)) {
+                options.units = &unit_cache;
+            }
+            free(units_dir);
+        }
+        success = success && solc_compile_batch(filenames, file_count, output_name ? units : NULL, unit_sizes,
+                jobs, &options);
+        if (success && output_name) {
+            solc_input input = { .filenames = filenames, .count = file_count, .units = units,
+                .unit_sizes = unit_sizes };
+            success = solc_write_program(ctx, &input, output, &options);
+        }
+        for (size_t i = 0; output_name && i < file_count; i++) {
+            free(units[i]);
+        }
+        solc_close_cache(&options);
+        solc_context_destroy(ctx);
+        sol_runtime_destroy();
+        return success ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    
+    // begin compilation, or execution
+    if (!flag_a && !flag_d) {
+        bool success = flag_e ? solc_execute_file(ctx, filename, &options)
+                : solc_compile_file(ctx, filename, output, &options);
+        solc_close_cache(&options);
+        solc_context_destroy(ctx);
+        sol_runtime_destroy();
+        return success ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
     FILE* in = fopen(filename, "r");
     if (in == NULL) {
         fprintf(stderr, "File '%s' could not be read.\n", filename);
+        solc_context_destroy(ctx);
+        sol_runtime_destroy();
         return EXIT_FAILURE;
     }
     
-    // get and write the binary file
-    off_t bin_size;
-    unsigned char* bin = solc_compile_f(in, &bin_size);
-    fclose(in);
-    if (!flag_c && !flag_e) {
-        char* bin_out_name = file_modify_extension(file_strip_path(filename), "solbin");
-        FILE* bin_out = fopen(bin_out_name, "wb");
-        fwrite(bin, bin_size, 1, bin_out);
-        fclose(bin_out);
-        free(bin_out_name);
+    // list the contents of a binary file
+    if (flag_d) {
+        size_t size;
+        unsigned char* image = file_read(in, &size);
+        fclose(in);
+        bool success = image != NULL;
+        if (!success) {
+            fprintf(stderr, "File '%s' could not be read.\n", filename);
+        } else if (!(success = solc_disassemble_ctx(ctx, image, size, stdout))) {
+            solc_print_error(ctx, filename);
+        }
+        free(image);
+        solc_context_destroy(ctx);
+        sol_runtime_destroy();
+        return success ? EXIT_SUCCESS : EXIT_FAILURE;
     }
     
-    // write C source file
-    if (!flag_b && !flag_e) {
-        char* out_name = file_modify_extension(file_strip_path(filename), "c");
-        FILE* out = flag_b ? NULL : fopen(out_name, "w");
-        solc_generate_c(bin, bin_size, out);
-        fclose(out);
-        free(out_name);
+    // parse the program
+    SolList program = solc_parse_f_ctx(ctx, in);
+    fclose(in);
+    if (program == NULL) {
+        solc_print_error(ctx, filename);
+        solc_context_destroy(ctx);
+        sol_runtime_destroy();
+        return EXIT_FAILURE;
     }
     
-    // execute program
-    if (flag_e) {
-        sol_runtime_execute(bin);
+    // translate the program to C that builds it directly
+    if (flag_O) {
+        SolList optimized = solc_optimize_ctx(ctx, program);
+        sol_obj_release((SolObject) program);
+        program = optimized;
+        if (time_passes) solc_print_pass_times(ctx);
     }
-    
+    char* out_name = file_modify_extension(output, "c");
+    FILE* out = fopen(out_name, "w");
+    bool success = out != NULL && solc_generate_c_program(program, out);
+    if (out && fclose(out)) success = false;
+    if (!success) {
+        fprintf(stderr, "File '%s' could not be written.\n", out_name);
+        if (out) remove(out_name);
+    }
+    free(out_name);
+    sol_obj_release((SolObject) program);
+    solc_context_destroy(ctx);
     sol_runtime_destroy();
-    
-    return EXIT_SUCCESS;
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
 void solc_repl_activate(void) {
     sol_runtime_init();
+    solc_context* ctx = solc_context_create();
     char* line;
     while ((line = linenoise("> "))) {
         if (line[0] != '\0') {
+            linenoiseHistoryAdd(line);
             // compile and execute input
-            unsigned char* bytecode = solc_compile(line, NULL);
+            unsigned char* bytecode = solc_compile_ctx(ctx, line, NULL);
+            if (bytecode == NULL) {
+                solc_print_error(ctx, NULL);
+                free(line);
+                continue;
+            }
             SolObject result = sol_runtime_execute(bytecode);
             // print output
             char* result_str = sol_obj_inspect(result);
@@ -130,36 +366,510 @@ void solc_repl_activate(void) {
             printf("%s\n", result_str);
             free(result_str);
             free(bytecode);
-            
-            linenoiseHistoryAdd(line);
         }
         free(line);
     }
+    solc_context_destroy(ctx);
     sol_runtime_destroy();
 }
 
+void solc_print_error(solc_context* ctx, char* filename) {
+    // batch workers report concurrently, so each message is written whole
+    const solc_diagnostic* error = solc_context_error(ctx);
+    flockfile(stderr);
+    if (filename) fprintf(stderr, "%s:", filename);
+    if (error->line) fprintf(stderr, "%zu:%zu:", error->line, error->column);
+    fprintf(stderr, "%serror while %s: %s\n", filename || error->line ? " " : "", error->stage, error->message);
+    funlockfile(stderr);
+}
+
+void solc_print_pass_times(solc_context* ctx) {
+    size_t count;
+    const solc_pass_stats* stats = solc_context_pass_stats(ctx, &count);
+    flockfile(stderr);
+    fprintf(stderr, "%-20s %12s %10s\n", "pass", "time (ms)", "rewrites");
+    for (size_t i = 0; i < count; i++) {
+        fprintf(stderr, "%-20s %12.3f %10zu\n", stats[i].name, stats[i].seconds * 1000, stats[i].rewrites);
+    }
+    funlockfile(stderr);
+}
+
+void solc_apply_options(solc_context* ctx, const solc_options* options) {
+    solc_context_set_format(ctx, options->format);
+    solc_context_set_optimize(ctx, options->optimize);
+    for (size_t i = 0; i < options->disabled_count; i++) {
+        solc_context_disable_pass(ctx, options->disabled_passes[i]);
+    }
+}
+
+bool solc_compile_file(solc_context* ctx, char* filename, char* output, const solc_options* options) {
+    if (options->cache) return solc_compile_cached(ctx, filename, output, options);
+    FILE* in = fopen(filename, "r");
+    if (in == NULL) {
+        fprintf(stderr, "File '%s' could not be read.\n", filename);
+        return false;
+    }
+    
+    // stream the binary file straight to disk when nothing else needs it
+    if (options->flag_b) {
+        char* bin_out_name = file_modify_extension(output, "solbin");
+        FILE* bin_out = fopen(bin_out_name, "wb");
+        bool success = bin_out != NULL;
+        if (!success) {
+            fprintf(stderr, "File '%s' could not be written.\n", bin_out_name);
+        } else {
+            success = solc_compile_stream_ctx(ctx, in, bin_out);
+            fclose(bin_out);
+            if (!success) {
+                solc_print_error(ctx, filename);
+                remove(bin_out_name);
+            } else if (options->time_passes) {
+                solc_print_pass_times(ctx);
+            }
+        }
+        free(bin_out_name);
+        fclose(in);
+        return success;
+    }
+    
+    // parse the program
+    SolList program = solc_parse_f_ctx(ctx, in);
+    fclose(in);
+    if (program == NULL) {
+        solc_print_error(ctx, filename);
+        return false;
+    }
+    solc_input input = { .program = program, .filenames = &filename, .count = 1 };
+    bool success = solc_write_program(ctx, &input, output, options);
+    sol_obj_release((SolObject) program);
+    return success;
+}
+
+bool solc_compile_cached(solc_context* ctx, char* filename, char* output, const solc_options* options) {
+    // the whole source is hashed for its key, so on a miss it is parsed from
+    // memory rather than streamed
+    size_t size;
+    unsigned char* source = file_read_path(filename, &size);
+    if (source == NULL) {
+        fprintf(stderr, "File '%s' could not be read.\n", filename);
+        return false;
+    }
+    char key[SOLC_CACHE_KEY_SIZE];
+    solc_cache_key(source, size, options->format, options->optimize, options->disabled_passes,
+            options->disabled_count, key);
+    solc_input input = { .filenames = &filename, .count = 1 };
+    bool success;
+    unsigned char* image = solc_cache_lookup(options->cache, ctx, key, options->format, &input.image_size);
+    if (image) {
+        input.image = image;
+        success = solc_write_program(ctx, &input, output, options);
+        free(image);
+    } else if ((input.program = solc_parse_n_ctx(ctx, (const char*) source, size)) == NULL) {
+        solc_print_error(ctx, filename);
+        success = false;
+    } else {
+        // a failure to store the entry only costs a later miss
+        solc_cache_entry entry;
+        if (solc_cache_store_begin(options->cache, &entry, key)) input.store = &entry;
+        success = solc_write_program(ctx, &input, output, options);
+        if (input.store) solc_cache_store_end(options->cache, &entry, success);
+        sol_obj_release((SolObject) input.program);
+    }
+    free(source);
+    return success;
+}
+
+bool solc_execute_file(solc_context* ctx, char* filename, const solc_options* options) {
+    size_t size;
+    unsigned char* source = file_read_path(filename, &size);
+    if (source == NULL) {
+        fprintf(stderr, "File '%s' could not be read.\n", filename);
+        return false;
+    }
+    char key[SOLC_CACHE_KEY_SIZE];
+    unsigned char* bin = NULL;
+    if (options->cache) {
+        size_t cached_size;
+        solc_cache_key(source, size, options->format, options->optimize, options->disabled_passes,
+                options->disabled_count, key);
+        bin = solc_cache_lookup(options->cache, ctx, key, options->format, &cached_size);
+    }
+    
+    // compile the program unless the cache already had it
+    if (bin == NULL) {
+        SolList program = solc_parse_n_ctx(ctx, (const char*) source, size);
+        off_t bin_size = 0;
+        if (program) {
+            bin = solc_emit_ctx(ctx, program, &bin_size);
+            sol_obj_release((SolObject) program);
+        }
+        if (bin == NULL) {
+            solc_print_error(ctx, filename);
+            free(source);
+            return false;
+        }
+        if (options->time_passes) solc_print_pass_times(ctx);
+        solc_cache_entry entry;
+        if (options->cache && solc_cache_store_begin(options->cache, &entry, key)) {
+            solc_cache_store_write(bin, bin_size, &entry);
+            solc_cache_store_end(options->cache, &entry, true);
+        }
+    }
+    free(source);
+    
+    // compilation memory is not needed while the program runs
+    solc_context_reset(ctx);
+    sol_runtime_execute(bin);
+    free(bin);
+    return true;
+}
+
+/*
+ * Emits the binary file and either C source or an object file side by
+ * side.
+ */
+bool solc_write_program(solc_context* ctx, const solc_input* input, char* output, const solc_options* options) {
+    solc_outputs outputs = { NULL, NULL, NULL, input->store };
+    solc_generator gen;
+    solc_elf_writer elf;
+    char* bin_out_name = options->flag_c ? NULL : file_modify_extension(output, "solbin");
+    char* out_name = options->flag_b ? NULL : file_modify_extension(output, options->flag_x ? "o" : "c");
+    bool success = true;
+    if (bin_out_name && !(outputs.bin = fopen(bin_out_name, "wb"))) {
+        fprintf(stderr, "File '%s' could not be written.\n", bin_out_name);
+        success = false;
+    }
+    FILE* out = success && out_name ? fopen(out_name, options->flag_x ? "wb" : "w") : NULL;
+    if (success && out_name && out == NULL) {
+        fprintf(stderr, "File '%s' could not be written.\n", out_name);
+        success = false;
+    }
+    if (success) {
+        bool written = true;
+        if (out && options->flag_x) {
+            written = solc_elf_begin(&elf, out, options->machine, "data");
+            outputs.elf = &elf;
+        } else if (out) {
+            solc_generate_c_begin(&gen, out, options->flag_s ? SOLC_GENERATE_STRING : SOLC_GENERATE_BYTES);
+            outputs.gen = &gen;
+        }
+        if (input->program) {
+            success = solc_emit_to_callback_ctx(ctx, input->program, solc_write_outputs, &outputs);
+            if (!success) solc_print_error(ctx, input->filenames[0]);
+        } else if (input->image) {
+            success = solc_write_outputs(input->image, input->image_size, &outputs);
+            if (!success) fprintf(stderr, "File '%s' could not be written.\n", out_name ? out_name : bin_out_name);
+        } else {
+            success = solc_link_units(ctx, input, &outputs);
+        }
+        if (success && out) {
+            written = options->flag_x ? written && solc_elf_end(&elf) : solc_generate_c_end(&gen);
+            if (!written) fprintf(stderr, "File '%s' could not be written.\n", out_name);
+            success = written;
+        }
+        if (success && options->time_passes) solc_print_pass_times(ctx);
+    }
+    if (outputs.bin) fclose(outputs.bin);
+    if (out && fclose(out) && success) {
+        fprintf(stderr, "File '%s' could not be written.\n", out_name);
+        success = false;
+    }
+    if (!success) {
+        if (outputs.bin) remove(bin_out_name);
+        if (out) remove(out_name);
+    }
+    
+    // the object file needs a main function to link against
+    if (success && out && options->flag_x) {
+        char* main_name = file_modify_extension(output, "main.c");
+        FILE* main_out = fopen(main_name, "w");
+        if (main_out == NULL || !solc_generate_c_main(main_out)) {
+            fprintf(stderr, "File '%s' could not be written.\n", main_name);
+            success = false;
+        }
+        if (main_out) fclose(main_out);
+        free(main_name);
+    }
+    free(bin_out_name);
+    free(out_name);
+    return success;
+}
+
+void solc_close_cache(const solc_options* options) {
+    solc_cache* caches[] = { options->cache, options->units != options->cache ? options->units : NULL };
+    const char* labels[] = { "cache", "units" };
+    for (int i = 0; i < 2; i++) {
+        solc_cache* cache = caches[i];
+        if (cache == NULL) continue;
+        solc_cache_close(cache);
+        if (options->cache_stats) {
+            fprintf(stderr, "%s: %zu hits, %zu misses, %zu stored, %zu evicted\n", labels[i], cache->hits,
+                    cache->misses, cache->stores, cache->evictions);
+        }
+    }
+}
+
+bool solc_compile_batch(char** filenames, size_t count, unsigned char** units, size_t* unit_sizes, long jobs,
+        const solc_options* options) {
+    char* outputs[units ? 1 : count];
+    solc_batch batch = {
+        .filenames = filenames, .outputs = outputs, .count = count, .units = units, .unit_sizes = unit_sizes,
+        .options = options
+    };
+    if (!units && !solc_batch_outputs(filenames, count, outputs)) {
+        fprintf(stderr, "Out of memory.\n");
+        return false;
+    }
+    pthread_mutex_init(&batch.lock, NULL);
+    
+    // the calling thread is a worker too, so the batch still runs if no
+    // thread can be started
+    if ((size_t) jobs > count) jobs = count;
+    pthread_t threads[jobs > 1 ? jobs - 1 : 1];
+    long started = 0;
+    while (started < jobs - 1 && !pthread_create(&threads[started], NULL, solc_batch_worker, &batch)) {
+        started++;
+    }
+    solc_batch_worker(&batch);
+    for (long i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    
+    // a worker without a context leaves its files to the others, so the
+    // batch fails only if none were left to take them
+    pthread_mutex_destroy(&batch.lock);
+    return batch.done == count && batch.failed == 0;
+}
+
+void* solc_batch_worker(void* data) {
+    solc_batch* batch = data;
+    solc_context* ctx = solc_context_create();
+    if (ctx && !batch->units) solc_apply_options(ctx, batch->options);
+    while (ctx) {
+        pthread_mutex_lock(&batch->lock);
+        size_t i = batch->next++;
+        pthread_mutex_unlock(&batch->lock);
+        if (i >= batch->count) break;
+        
+        // units report only their errors; whole programs also get a status
+        // line as each finishes, on stderr with the errors so that it is
+        // never mixed into what the programs write
+        char* filename = batch->filenames[i];
+        bool success;
+        if (batch->units) {
+            success = solc_compile_unit(ctx, filename, batch->options->units, &batch->units[i],
+                    &batch->unit_sizes[i]);
+        } else {
+            success = batch->outputs[i] && solc_compile_file(ctx, filename, batch->outputs[i], batch->options);
+            solc_context_reset(ctx);
+            fprintf(stderr, "%s: %s\n", filename, success ? "ok" : "failed");
+        }
+        pthread_mutex_lock(&batch->lock);
+        batch->done++;
+        if (!success) batch->failed++;
+        pthread_mutex_unlock(&batch->lock);
+    }
+    solc_context_destroy(ctx);
+    return NULL;
+}
+
+bool solc_batch_outputs(char** filenames, size_t count, char** outputs) {
+    // outputs go to the working directory under the file's name, so files
+    // from different directories can clash; sorting puts clashing files
+    // together, the one given first ahead of the rest, and it alone is kept
+    char*** sorted = malloc(count * sizeof(*sorted));
+    if (sorted == NULL) return false;
+    for (size_t i = 0; i < count; i++) {
+        outputs[i] = file_strip_path(filenames[i]);
+        sorted[i] = &filenames[i];
+    }
+    qsort(sorted, count, sizeof(*sorted), compare_outputs);
+    for (size_t i = 0, first = 0; i < count; i++) {
+        if (i > first && !compare_output_names(*sorted[i], *sorted[first])) {
+            fprintf(stderr, "File '%s' would be written to the same output as '%s'.\n", *sorted[i], *sorted[first]);
+            outputs[sorted[i] - filenames] = NULL;
+        } else {
+            first = i;
+        }
+    }
+    free(sorted);
+    return true;
+}
+
+int compare_outputs(const void* a, const void* b) {
+    char** const* first = a;
+    char** const* second = b;
+    int order = compare_output_names(**first, **second);
+    return order ? order : (*first > *second) - (*first < *second);
+}
+
+int compare_output_names(char* a, char* b) {
+    // names compare without their extension, since that is replaced
+    a = file_strip_path(a);
+    b = file_strip_path(b);
+    size_t a_length = file_find_extension(a) - a;
+    size_t b_length = file_find_extension(b) - b;
+    int order = memcmp(a, b, a_length < b_length ? a_length : b_length);
+    if (order == 0 && a_length != b_length) order = a_length < b_length ? -1 : 1;
+    return order;
+}
+
+bool solc_write_outputs(const unsigned char* bytes, size_t size, void* data) {
+    solc_outputs* outputs = data;
+    if (outputs->bin && fwrite(bytes, size, 1, outputs->bin) != 1) return false;
+    if (outputs->gen && !solc_generate_c_write(bytes, size, outputs->gen)) return false;
+    if (outputs->elf && !solc_elf_write(bytes, size, outputs->elf)) return false;
+    // a cache entry that cannot be written is dropped, not the compilation
+    if (outputs->cache) solc_cache_store_write(bytes, size, outputs->cache);
+    return true;
+}
+
+bool solc_check_units(char** filenames, size_t count, char* output, const solc_options* options) {
+    // files are told apart by device and inode, so a unit named two ways
+    // is still found; files that cannot be read are reported when compiled
+    struct stat inputs[count];
+    bool found[count];
+    bool success = true;
+    for (size_t i = 0; i < count; i++) {
+        found[i] = !stat(filenames[i], &inputs[i]);
+        for (size_t j = 0; found[i] && j < i; j++) {
+            if (found[j] && inputs[i].st_dev == inputs[j].st_dev && inputs[i].st_ino == inputs[j].st_ino) {
+                fprintf(stderr, "File '%s' is the same unit as '%s'.\n", filenames[i], filenames[j]);
+                success = false;
+                break;
+            }
+        }
+    }
+    
+    // no output may replace one of the units
+    char* outputs[] = {
+        options->flag_c ? NULL : file_modify_extension(output, "solbin"),
+        options->flag_b ? NULL : file_modify_extension(output, options->flag_x ? "o" : "c"),
+        options->flag_x && !options->flag_b ? file_modify_extension(output, "main.c") : NULL
+    };
+    for (int i = 0; i < 3; i++) {
+        struct stat output_stat;
+        if (outputs[i] == NULL || stat(outputs[i], &output_stat)) continue;
+        for (size_t j = 0; j < count; j++) {
+            if (found[j] && output_stat.st_dev == inputs[j].st_dev && output_stat.st_ino == inputs[j].st_ino) {
+                fprintf(stderr, "Output '%s' would overwrite '%s'.\n", outputs[i], filenames[j]);
+                success = false;
+            }
+        }
+    }
+    for (int i = 0; i < 3; i++) {
+        free(outputs[i]);
+    }
+    return success;
+}
+
+bool solc_compile_unit(solc_context* ctx, char* filename, solc_cache* cache, unsigned char** image, size_t* size) {
+    size_t source_size;
+    unsigned char* source = file_read_path(filename, &source_size);
+    if (source == NULL) {
+        fprintf(stderr, "File '%s' could not be read.\n", filename);
+        return false;
+    }
+    
+    char key[SOLC_CACHE_KEY_SIZE];
+    if (cache) {
+        solc_cache_key(source, source_size, SOLC_UNIT_FORMAT, false, NULL, 0, key);
+        *image = solc_cache_lookup(cache, ctx, key, SOLC_UNIT_FORMAT, size);
+        if (*image) {
+            free(source);
+            return true;
+        }
+    }
+    solc_context_set_format(ctx, SOLC_UNIT_FORMAT);
+    solc_context_set_optimize(ctx, false);
+    SolList program = solc_parse_n_ctx(ctx, (const char*) source, source_size);
+    off_t image_size = 0;
+    *image = program ? solc_emit_ctx(ctx, program, &image_size) : NULL;
+    if (program) sol_obj_release((SolObject) program);
+    free(source);
+    if (*image == NULL) {
+        solc_print_error(ctx, filename);
+    } else {
+        *size = image_size;
+        solc_cache_entry entry;
+        if (cache && solc_cache_store_begin(cache, &entry, key)) {
+            solc_cache_store_write(*image, *size, &entry);
+            solc_cache_store_end(cache, &entry, true);
+        }
+    }
+    // units share nothing, so each starts from an empty context
+    solc_context_reset(ctx);
+    return *image != NULL;
+}
+
+bool solc_link_units(solc_context* ctx, const solc_input* input, solc_outputs* outputs) {
+    bool success = true;
+    solc_link_begin_ctx(ctx, solc_write_outputs, outputs);
+    for (size_t i = 0; i < input->count && success; i++) {
+        if (!(success = solc_link_unit_ctx(ctx, input->units[i], input->unit_sizes[i]))) {
+            solc_print_error(ctx, input->filenames[i]);
+        }
+    }
+    if (!solc_link_end_ctx(ctx) && success) {
+        solc_print_error(ctx, NULL);
+        success = false;
+    }
+    return success;
+}
+
+unsigned char* file_read(FILE* file, size_t* size) {
+    size_t capacity = 4096, length = 0, read;
+    unsigned char* data = malloc(capacity);
+    while (data && (read = fread(data + length, 1, capacity - length, file)) > 0) {
+        length += read;
+        if (length == capacity) {
+            unsigned char* grown = realloc(data, capacity *= 2);
+            if (grown == NULL) free(data);
+            data = grown;
+        }
+    }
+    if (data && ferror(file)) {
+        free(data);
+        return NULL;
+    }
+    *size = length;
+    return data;
+}
+
+unsigned char* file_read_path(char* filename, size_t* size) {
+    FILE* file = fopen(filename, "rb");
+    if (file == NULL) return NULL;
+    unsigned char* data = file_read(file, size);
+    fclose(file);
+    return data;
+}
+
 char* file_strip_path(char* file) {
     char* slash = strrchr(file, '/');
     if (slash == NULL) return file;
     return slash + 1;
 }
 
+char* file_find_extension(char* file) {
+    // only a dot in the last path component starts an extension, so that
+    // paths such as build.d/app or ../app keep their directories
+    char* dot = strrchr(file_strip_path(file), '.');
+    return dot ? dot : file + strlen(file);
+}
+
 char* file_get_name(char* file) {
-    const char* dot = strrchr(file, '.');
-    if (dot == NULL) dot = file + strlen(file);
+    const char* dot = file_find_extension(file);
     char* name = malloc(dot - file + 1);
     memcpy(name, file, dot - file);
-    name[dot - file + 1] = '\0';
+    name[dot - file] = '\0';
     return name;
 }
 
 char* file_modify_extension(char* file, char* ext) {
-    const char* dot = strrchr(file, '.');
-    if (dot == NULL) dot = file + strlen(file);
+    const char* dot = file_find_extension(file);
     char* name = malloc(dot - file + strlen(ext) + 2);
     memcpy(name, file, dot - file);
     name[dot - file] = '.';
     memcpy(name + (dot - file) + 1, ext, strlen(ext) + 1);
     return name;
 }
-
@@ -1,17 +1,201 @@
-
 #include <sys/types.h>
+#include <string.h>
+#include <stdarg.h>
 #include "solc.h"
+#include "solccontext.h"
+
+static const char* atom_names[SOLC_ATOM_COUNT] = {
+    "freeze", "list", "@list", "get", "@get", "Object", "create", "clone",
+    "^", "#", "true", "false", "+", "-", "*", "/"
+};
+
+static void context_clear_tokens(solc_context* ctx);
+
+solc_context* solc_context_create(void) {
+    solc_context* ctx = calloc(1, sizeof(*ctx));
+    if (ctx == NULL) return NULL;
+    solc_arena_init(&ctx->arena, SOLC_ARENA_BLOCK_SIZE);
+    solc_table_init(&ctx->tokens);
+    solc_pool_init(&ctx->pool);
+    solc_share_init(&ctx->share);
+    return ctx;
+}
+
+void solc_context_reset(solc_context* ctx) {
+    solc_parse_unwind(ctx);
+    context_clear_tokens(ctx);
+    solc_arena_reset(&ctx->arena);
+    ctx->scratch = NULL;
+    ctx->scratch_size = 0;
+}
+
+void solc_context_destroy(solc_context* ctx) {
+    if (ctx == NULL) return;
+    solc_parse_unwind(ctx);
+    free(ctx->frames);
+    free(ctx->out.data);
+    free(ctx->index);
+    context_clear_tokens(ctx);
+    solc_table_destroy(&ctx->tokens);
+    solc_pool_destroy(&ctx->pool);
+    solc_share_destroy(&ctx->share);
+    if (ctx->pending) sol_obj_release((SolObject) ctx->pending);
+    solc_arena_destroy(&ctx->arena);
+    free(ctx);
+}
+
+void solc_context_set_format(solc_context* ctx, unsigned int format) {
+    ctx->format = format;
+}
+
+const solc_diagnostic* solc_context_error(solc_context* ctx) {
+    return ctx->failed ? &ctx->error : NULL;
+}
+
+void solc_begin(solc_context* ctx) {
+    ctx->failed = false;
+    ctx->line_base = ctx->column_base = 1;
+}
+
+void solc_error(solc_context* ctx, const char* stage, const char* position, const char* format, ...) {
+    // only the first error of a call is kept, since later ones cascade
+    if (ctx->failed) return;
+    ctx->failed = true;
+    ctx->error.stage = stage;
+    ctx->error.line = ctx->error.column = 0;
+    if (position) {
+        ctx->error.line = ctx->line_base;
+        ctx->error.column = ctx->column_base;
+        for (const char* p = ctx->begin; p < position; p++) {
+            if (*p == '\n') {
+                ctx->error.line++;
+                ctx->error.column = 1;
+            } else {
+                ctx->error.column++;
+            }
+        }
+    }
+    va_list args;
+    va_start(args, format);
+    vsnprintf(ctx->error.message, sizeof(ctx->error.message), format, args);
+    va_end(args);
+}
+
+void solc_exit_on_error(solc_context* ctx) {
+    if (!ctx->failed) return;
+    if (ctx->error.line) {
+        fprintf(stderr, "solc: error while %s: line %zu, column %zu: %s\n", ctx->error.stage,
+                ctx->error.line, ctx->error.column, ctx->error.message);
+    } else {
+        fprintf(stderr, "solc: error while %s: %s\n", ctx->error.stage, ctx->error.message);
+    }
+    exit(EXIT_FAILURE);
+}
+
+void solc_advance_position(solc_context* ctx, const char* to) {
+    // moves begin forward, keeping line_base and column_base in step
+    const char* p = ctx->begin;
+    const char* newline;
+    while ((newline = memchr(p, '\n', to - p))) {
+        ctx->line_base++;
+        ctx->column_base = 1;
+        p = newline + 1;
+    }
+    ctx->column_base += to - p;
+    ctx->begin = to;
+}
+
+char* solc_context_scratch(solc_context* ctx, size_t size) {
+    // grow geometrically, carrying over the current contents; the old buffer
+    // stays in the arena until the context is reset
+    if (size > ctx->scratch_size) {
+        size_t new_size = ctx->scratch_size ? ctx->scratch_size : SOLC_SCRATCH_SIZE;
+        while (new_size < size) {
+            new_size *= 2;
+        }
+        char* scratch = solc_arena_alloc(&ctx->arena, new_size);
+        if (scratch == NULL) {
+            solc_error(ctx, "compiling", NULL, "out of memory");
+            return NULL;
+        }
+        if (ctx->scratch) memcpy(scratch, ctx->scratch, ctx->scratch_size);
+        ctx->scratch = scratch;
+        ctx->scratch_size = new_size;
+    }
+    return ctx->scratch;
+}
+
+SolToken solc_intern(solc_context* ctx, const char* identifier, size_t length) {
+    uint64_t hash = solc_hash(identifier, length);
+    solc_table_entry* entry = solc_table_lookup(&ctx->tokens, identifier, length, hash);
+    if (entry) return entry->value;
+    // the key copy doubles as the NUL-terminated name handed to libsol
+    char* key = solc_arena_strndup(&ctx->arena, identifier, length);
+    entry = key ? solc_table_insert(&ctx->tokens, key, length, hash) : NULL;
+    if (entry == NULL) {
+        solc_error(ctx, "compiling", NULL, "out of memory");
+        return NULL;
+    }
+    entry->value = sol_obj_retain((SolObject) sol_token_create(key));
+    return entry->value;
+}
+
+SolToken solc_atom(solc_context* ctx, solc_atom_id atom) {
+    if (ctx->atoms[atom] == NULL) {
+        ctx->atoms[atom] = solc_intern(ctx, atom_names[atom], strlen(atom_names[atom]));
+        // the call has already failed, but callers still get a token to
+        // compare against or insert, just not an interned one
+        if (ctx->atoms[atom] == NULL) return sol_token_create((char*) atom_names[atom]);
+    }
+    return ctx->atoms[atom];
+}
+
+bool solc_is_atom(solc_context* ctx, SolToken token, solc_atom_id atom) {
+    // tokens parsed with this context are interned, so a pointer comparison
+    // settles it; tokens from elsewhere only need a string comparison when
+    // their first character matches
+    SolToken interned = solc_atom(ctx, atom);
+    if (token == interned) return true;
+    return token->identifier[0] == interned->identifier[0]
+            && !strcmp(token->identifier, interned->identifier);
+}
+
+static void context_clear_tokens(solc_context* ctx) {
+    SOLC_TABLE_ITR(&ctx->tokens, entry) {
+        sol_obj_release((SolObject) entry->value);
+    }
+    solc_table_clear(&ctx->tokens);
+    memset(ctx->atoms, 0, sizeof(ctx->atoms));
+}
 
 unsigned char* solc_compile(char* source, off_t* size) {
-    SolList data = solc_parse(source);
-    unsigned char* ret = solc_emit(data, size);
-    sol_obj_release((SolObject) data);
+    solc_context* ctx = solc_context_create();
+    unsigned char* ret = solc_compile_ctx(ctx, source, size);
+    solc_exit_on_error(ctx);
+    solc_context_destroy(ctx);
     return ret;
 }
 
 unsigned char* solc_compile_f(FILE* source, off_t* size) {
-    SolList data = solc_parse_f(source);
-    unsigned char* ret = solc_emit(data, size);
+    solc_context* ctx = solc_context_create();
+    unsigned char* ret = solc_compile_f_ctx(ctx, source, size);
+    solc_exit_on_error(ctx);
+    solc_context_destroy(ctx);
+    return ret;
+}
+
+unsigned char* solc_compile_ctx(solc_context* ctx, char* source, off_t* size) {
+    SolList data = solc_parse_ctx(ctx, source);
+    if (data == NULL) return NULL;
+    unsigned char* ret = solc_emit_ctx(ctx, data, size);
+    sol_obj_release((SolObject) data);
+    return ret;
+}
+
+unsigned char* solc_compile_f_ctx(solc_context* ctx, FILE* source, off_t* size) {
+    SolList data = solc_parse_f_ctx(ctx, source);
+    if (data == NULL) return NULL;
+    unsigned char* ret = solc_emit_ctx(ctx, data, size);
     sol_obj_release((SolObject) data);
     return ret;
 }
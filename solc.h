@@ -10,16 +10,210 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdbool.h>
 #include <sol/runtime.h>
 #include <sys/types.h>
 
+/*
+ * The compiler version. It is part of the key of every compile cache entry,
+ * so it changes whenever the binary emitted for a source could.
+ */
+#define SOLC_VERSION "1.1.0"
+
+/*
+ * A compiler context owns all of the parser and emitter state for a single
+ * compilation. Contexts are independent of one another, so separate threads
+ * may each compile with their own context concurrently. The functions
+ * without a context argument create a temporary one per call.
+ */
+typedef struct solc_context solc_context;
+
+/*
+ * Describes the error that made the last call on a context fail. Line and
+ * column are 1-based and refer to the source being parsed; both are 0 when
+ * the error has no source position, such as an I/O error while emitting.
+ */
+typedef struct solc_diagnostic {
+    const char* stage;
+    size_t line;
+    size_t column;
+    char message[256];
+} solc_diagnostic;
+
+solc_context* solc_context_create(void);
+void solc_context_destroy(solc_context* ctx);
+/*
+ * Temporary memory used during compilation is allocated from an arena owned
+ * by the context and kept for reuse by later compilations. Resetting the
+ * context releases all of it at once.
+ */
+void solc_context_reset(solc_context* ctx);
+/*
+ * Returns the diagnostic for the last failed call on ctx, or NULL if the
+ * last call succeeded. Functions taking a context report failure by
+ * returning NULL (or false) and leave the context ready for reuse; those
+ * without one print the diagnostic and exit.
+ */
+const solc_diagnostic* solc_context_error(solc_context* ctx);
+
+/*
+ * SOLBIN format options used by the emitter. With none set the original
+ * version 1 format is written; any option selects version 2, which follows
+ * the magic with a 0xFE marker, the version number and the options byte so
+ * that loaders can tell which encodings to expect.
+ *
+ * SOLC_FORMAT_POOL stores each token and string used more than once in a
+ * constant pool ahead of the forms, which then refer to it by index. The
+ * pool must be complete before the first form is written, so streaming
+ * compilation holds all forms in memory when it is set.
+ *
+ * SOLC_FORMAT_INDEX appends an index of the top-level forms after the
+ * terminating 0x0: a big-endian 64-bit offset and length for each form,
+ * then the number of forms and the 8 bytes "SOLINDEX". Loaders can map
+ * the image and decode forms on demand; see solc_index_form.
+ *
+ * SOLC_FORMAT_NUMBERS picks the shortest exact encoding for each number:
+ * opcode 0x8 with one signed byte for integers from -128 to 127, 0x9 with
+ * a zigzag LEB128 varint for other integers up to 2^53 in magnitude, and
+ * 0xA with the big-endian IEEE-754 bits for everything else. Unlike the
+ * version 1 encoding, which keeps only 52 bits of significand, every
+ * double survives the round trip.
+ *
+ * SOLC_FORMAT_VARINT writes every list, token and string length as an
+ * unsigned LEB128 varint in place of the four fixed-size tiers, which
+ * cannot go above 2^28 - 1. Lengths below 128 take one byte.
+ *
+ * SOLC_FORMAT_SHARE writes a list that is equal to an earlier one in the
+ * same top-level form as opcode 0xB and a varint id. Ids number the lists
+ * written out in full within each form, from 0 in the order they start,
+ * and a loader may hand back the same list object for every reference.
+ */
+#define SOLC_FORMAT_POOL 0x01
+#define SOLC_FORMAT_INDEX 0x02
+#define SOLC_FORMAT_NUMBERS 0x04
+#define SOLC_FORMAT_VARINT 0x08
+#define SOLC_FORMAT_SHARE 0x10
+#define SOLC_FORMAT_ALL (SOLC_FORMAT_POOL | SOLC_FORMAT_INDEX | SOLC_FORMAT_NUMBERS | SOLC_FORMAT_VARINT \
+        | SOLC_FORMAT_SHARE)
+
+void solc_context_set_format(solc_context* ctx, unsigned int format);
+
 SolList solc_parse(char* source);
 SolList solc_parse_f(FILE* source);
+SolList solc_parse_ctx(solc_context* ctx, char* source);
+/*
+ * Parses exactly length bytes of source. The buffer is never written to and
+ * need not be NUL-terminated, so it may be a read-only file mapping.
+ */
+SolList solc_parse_n(const char* source, size_t length);
+SolList solc_parse_n_ctx(solc_context* ctx, const char* source, size_t length);
+SolList solc_parse_f_ctx(solc_context* ctx, FILE* source);
+
+/*
+ * Streaming parses read the source in fixed-size chunks and hand each
+ * top-level form to the callback as soon as it is complete. The form is
+ * released after the callback returns, so memory use is bounded by the
+ * largest single form rather than by the size of the program.
+ */
+typedef void (*solc_form_callback)(SolObject form, void* data);
+
+void solc_parse_stream(FILE* source, solc_form_callback callback, void* data);
+bool solc_parse_stream_ctx(solc_context* ctx, FILE* source, solc_form_callback callback, void* data);
 
 unsigned char* solc_emit(SolList source, off_t* size);
+unsigned char* solc_emit_ctx(solc_context* ctx, SolList source, off_t* size);
+
+/*
+ * Emits SOLBIN to a sink rather than into a new buffer. The callback is
+ * handed the output in order, a block at a time as the emitter's buffer
+ * fills, and returns false to abort. solc_emit_to_buffer writes into the
+ * caller's capacity bytes at buffer and fails if the output does not fit;
+ * the length written is returned, or stored in *size.
+ */
+typedef bool (*solc_write_callback)(const unsigned char* bytes, size_t size, void* data);
+
+void solc_emit_to_callback(SolList source, solc_write_callback callback, void* data);
+void solc_emit_to_fd(SolList source, int fd);
+size_t solc_emit_to_buffer(SolList source, unsigned char* buffer, size_t capacity);
+bool solc_emit_to_callback_ctx(solc_context* ctx, SolList source, solc_write_callback callback, void* data);
+bool solc_emit_to_fd_ctx(solc_context* ctx, SolList source, int fd);
+bool solc_emit_to_buffer_ctx(solc_context* ctx, SolList source, unsigned char* buffer, size_t capacity, size_t* size);
 
 unsigned char* solc_compile(char* source, off_t* size);
 unsigned char* solc_compile_f(FILE* source, off_t* size);
+unsigned char* solc_compile_ctx(solc_context* ctx, char* source, off_t* size);
+unsigned char* solc_compile_f_ctx(solc_context* ctx, FILE* source, off_t* size);
+/*
+ * Compiles source to SOLBIN written directly to output, one top-level form
+ * at a time.
+ */
+void solc_compile_stream(FILE* source, FILE* output);
+bool solc_compile_stream_ctx(solc_context* ctx, FILE* source, FILE* output);
+
+/*
+ * Optimization rewrites each top-level form between parsing and emitting
+ * when it is enabled on a context, so that the runtime has less to evaluate.
+ * Every pass returns a new form and leaves the one it was given intact,
+ * sharing the parts it did not change. The passes, in order, are:
+ *
+ * "fold-freeze" unwraps (freeze x) when x is a literal number, string or
+ * boolean, since those evaluate to themselves.
+ *
+ * "fold-arithmetic" replaces the calls [+ a b], [- a b], [* a b] and
+ * [/ a b] with the result when both operands are literal numbers, assuming
+ * the operators still name the builtins. Only statement lists are calls:
+ * data literals such as (+ 1 2), which is parsed as (list + 1 2), and
+ * frozen lists are left alone, as is division by zero.
+ *
+ * Passes can be disabled by name. The time spent in each pass and the
+ * number of rewrites it made accumulate in the context.
+ */
+typedef struct solc_pass_stats {
+    const char* name;
+    double seconds;
+    size_t rewrites;
+} solc_pass_stats;
+
+void solc_context_set_optimize(solc_context* ctx, bool optimize);
+bool solc_context_disable_pass(solc_context* ctx, const char* name);
+const solc_pass_stats* solc_context_pass_stats(solc_context* ctx, size_t* count);
+SolList solc_optimize_ctx(solc_context* ctx, SolList program);
+
+/*
+ * Decodes a SOLBIN image back into the list of its top-level forms. Every
+ * read is checked against the end of the image, so truncated or corrupt
+ * input is reported as an error rather than read past. solc_verify_ctx
+ * performs the same checks without building any objects, and
+ * solc_disassemble writes a listing of the image to out, one line per
+ * object with its offset.
+ */
+SolList solc_decode(const unsigned char* image, size_t size);
+SolList solc_decode_ctx(solc_context* ctx, const unsigned char* image, size_t size);
+bool solc_verify_ctx(solc_context* ctx, const unsigned char* image, size_t size);
+bool solc_disassemble(const unsigned char* image, size_t size, FILE* out);
+bool solc_disassemble_ctx(solc_context* ctx, const unsigned char* image, size_t size, FILE* out);
+
+/*
+ * Reads the form index of an image written with SOLC_FORMAT_INDEX.
+ * solc_index_count returns the number of top-level forms, or 0 if the image
+ * has no valid index. solc_index_form finds the encoding of form n, which
+ * starts offset bytes into the image and spans length bytes.
+ */
+size_t solc_index_count(const unsigned char* image, size_t size);
+bool solc_index_form(const unsigned char* image, size_t size, size_t n, size_t* offset, size_t* length);
+
+/*
+ * Links separately compiled units into a single SOLBIN image written to a
+ * sink. Each unit is an image in any format; its forms are decoded and
+ * emitted in turn with the context's format and optimization settings, so
+ * with SOLC_FORMAT_POOL one constant pool is built across all of them.
+ * Pools, shared lists and indices are local to an image, so nothing in a
+ * unit needs relocating. A unit that fails to decode fails the link, but
+ * solc_link_end_ctx must still be called to finish it.
+ */
+void solc_link_begin_ctx(solc_context* ctx, solc_write_callback callback, void* data);
+bool solc_link_unit_ctx(solc_context* ctx, const unsigned char* image, size_t size);
+bool solc_link_end_ctx(solc_context* ctx);
 
 #endif	/* SOLC_H */
 
@@ -0,0 +1,91 @@
+#include "solcarena.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SOLC_ARENA_ALIGN sizeof(void*)
+
+static solc_arena_block* arena_block_create(size_t size);
+
+void solc_arena_init(solc_arena* arena, size_t block_size) {
+    arena->head = NULL;
+    arena->block_size = block_size;
+    arena->block_count = 0;
+}
+
+void* solc_arena_alloc(solc_arena* arena, size_t size) {
+    size = (size + SOLC_ARENA_ALIGN - 1) & ~(SOLC_ARENA_ALIGN - 1);
+    solc_arena_block* block = arena->head;
+    if (block == NULL || block->size - block->used < size) {
+        if (size > arena->block_size / 4) {
+            // oversized requests get a dedicated block behind the current one
+            // so the remaining space in the current block is not abandoned
+            solc_arena_block* large = arena_block_create(size);
+            if (large == NULL) return NULL;
+            large->used = size;
+            if (block) {
+                large->next = block->next;
+                block->next = large;
+            } else {
+                arena->head = large;
+            }
+            arena->block_count++;
+            return large->data;
+        }
+        block = arena_block_create(arena->block_size);
+        if (block == NULL) return NULL;
+        block->next = arena->head;
+        arena->head = block;
+        arena->block_count++;
+    }
+    void* ret = block->data + block->used;
+    block->used += size;
+    return ret;
+}
+
+char* solc_arena_strndup(solc_arena* arena, const char* str, size_t length) {
+    char* ret = solc_arena_alloc(arena, length + 1);
+    if (ret == NULL) return NULL;
+    memcpy(ret, str, length);
+    ret[length] = '\0';
+    return ret;
+}
+
+void solc_arena_reset(solc_arena* arena) {
+    // keep a single standard block around for reuse
+    solc_arena_block* keep = NULL;
+    solc_arena_block* block = arena->head;
+    while (block) {
+        solc_arena_block* next = block->next;
+        if (keep == NULL && block->size == arena->block_size) {
+            keep = block;
+            keep->used = 0;
+            keep->next = NULL;
+        } else {
+            free(block);
+        }
+        block = next;
+    }
+    arena->head = keep;
+    arena->block_count = keep ? 1 : 0;
+}
+
+void solc_arena_destroy(solc_arena* arena) {
+    solc_arena_block* block = arena->head;
+    while (block) {
+        solc_arena_block* next = block->next;
+        free(block);
+        block = next;
+    }
+    arena->head = NULL;
+    arena->block_count = 0;
+}
+
+static solc_arena_block* arena_block_create(size_t size) {
+    solc_arena_block* block = malloc(sizeof(*block) + size);
+    if (block == NULL) return NULL;
+    block->next = NULL;
+    block->size = size;
+    block->used = 0;
+    return block;
+}
@@ -0,0 +1,36 @@
+/* 
+ * File:   solcarena.h
+ *
+ * Created on October 16, 2026
+ */
+
+#ifndef SOLCARENA_H
+#define	SOLCARENA_H
+
+#include <stddef.h>
+
+/*
+ * A bump allocator for memory that lives as long as a compilation. Individual
+ * allocations are never freed; the whole arena is released at once.
+ */
+typedef struct solc_arena_block {
+    struct solc_arena_block* next;
+    size_t size;
+    size_t used;
+    unsigned char data[];
+} solc_arena_block;
+
+typedef struct solc_arena {
+    solc_arena_block* head;
+    size_t block_size;
+    size_t block_count;
+} solc_arena;
+
+void solc_arena_init(solc_arena* arena, size_t block_size);
+void* solc_arena_alloc(solc_arena* arena, size_t size);
+char* solc_arena_strndup(solc_arena* arena, const char* str, size_t length);
+void solc_arena_reset(solc_arena* arena);
+void solc_arena_destroy(solc_arena* arena);
+
+#endif	/* SOLCARENA_H */
+
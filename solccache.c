@@ -0,0 +1,255 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "solc.h"
+#include "solccache.h"
+
+#define SOLC_CACHE_SUFFIX ".solbin"
+#define SOLC_CACHE_TEMP "tmp.XXXXXX"
+
+// the 128-bit FNV-1a state, as two 64-bit halves
+typedef struct cache_hash {
+    uint64_t high;
+    uint64_t low;
+} cache_hash;
+
+// an entry found while evicting
+typedef struct cache_file {
+    char* name;
+    uint64_t size;
+    struct timespec modified;
+} cache_file;
+
+static void hash_update(cache_hash* hash, const void* data, size_t length);
+static bool entry_valid(solc_context* ctx, const unsigned char* image, size_t size, unsigned int format);
+static char* cache_path(solc_cache* cache, const char* name);
+static uint64_t parse_size(const char* text);
+static void evict(solc_cache* cache);
+static int compare_files(const void* a, const void* b);
+
+bool solc_cache_open(solc_cache* cache) {
+    memset(cache, 0, sizeof(*cache));
+    const char* dir = getenv("SOLC_CACHE_DIR");
+    if (dir == NULL || *dir == '\0') return false;
+    return solc_cache_open_dir(cache, dir);
+}
+
+bool solc_cache_open_dir(solc_cache* cache, const char* dir) {
+    memset(cache, 0, sizeof(*cache));
+    if (mkdir(dir, 0777) && errno != EEXIST) return false;
+    const char* size = getenv("SOLC_CACHE_SIZE");
+    cache->max_size = size && *size ? parse_size(size) : SOLC_CACHE_DEFAULT_SIZE;
+    cache->dir = strdup(dir);
+    if (cache->dir == NULL) return false;
+    pthread_mutex_init(&cache->lock, NULL);
+    return true;
+}
+
+void solc_cache_close(solc_cache* cache) {
+    if (cache->dir == NULL) return;
+    if (cache->stores) evict(cache);
+    pthread_mutex_destroy(&cache->lock);
+    free(cache->dir);
+    cache->dir = NULL;
+}
+
+void solc_cache_key(const unsigned char* source, size_t size, unsigned int format, bool optimize,
+        char** disabled_passes, size_t disabled_count, char* key) {
+    cache_hash hash = { 0x6c62272e07bb0142ULL, 0x62b821756295c58dULL };
+    // every field is terminated so that no two sets of options run together
+    hash_update(&hash, "solc " SOLC_VERSION, sizeof("solc " SOLC_VERSION));
+    unsigned char options[2] = { format, optimize };
+    hash_update(&hash, options, sizeof(options));
+    for (size_t i = 0; i < disabled_count; i++) {
+        hash_update(&hash, disabled_passes[i], strlen(disabled_passes[i]) + 1);
+    }
+    hash_update(&hash, "", 1);
+    hash_update(&hash, source, size);
+    snprintf(key, SOLC_CACHE_KEY_SIZE, "%016llx%016llx", (unsigned long long) hash.high,
+            (unsigned long long) hash.low);
+}
+
+unsigned char* solc_cache_lookup(solc_cache* cache, solc_context* ctx, const char* key, unsigned int format,
+        size_t* size) {
+    char* path = cache_path(cache, key);
+    FILE* in = path ? fopen(path, "rb") : NULL;
+    unsigned char* image = NULL;
+    struct stat in_stat;
+    bool corrupt = false;
+    if (in && !fstat(fileno(in), &in_stat)) {
+        image = malloc(in_stat.st_size ? in_stat.st_size : 1);
+        if (image && (fread(image, in_stat.st_size, 1, in) != 1
+                || !entry_valid(ctx, image, in_stat.st_size, format))) {
+            free(image);
+            image = NULL;
+            corrupt = true;
+        }
+        *size = in_stat.st_size;
+    }
+    if (in) fclose(in);
+    
+    // a hit counts as a use for eviction, and an entry that cannot be used
+    // would only miss again
+    if (image) utimensat(AT_FDCWD, path, NULL, 0);
+    if (corrupt) remove(path);
+    free(path);
+    pthread_mutex_lock(&cache->lock);
+    if (image) {
+        cache->hits++;
+    } else {
+        cache->misses++;
+    }
+    pthread_mutex_unlock(&cache->lock);
+    return image;
+}
+
+static bool entry_valid(solc_context* ctx, const unsigned char* image, size_t size, unsigned int format) {
+    if (size < 7 || memcmp(image, "SOLBIN", 6)) return false;
+    if (format) {
+        if (size < 9 || image[6] != 0xFE || image[7] != 0x2 || image[8] != format) return false;
+    } else if (image[6] == 0xFE) {
+        return false;
+    }
+    return solc_verify_ctx(ctx, image, size);
+}
+
+bool solc_cache_store_begin(solc_cache* cache, solc_cache_entry* entry, const char* key) {
+    entry->out = NULL;
+    entry->failed = false;
+    entry->temp_name = cache_path(cache, SOLC_CACHE_TEMP);
+    memcpy(entry->key, key, SOLC_CACHE_KEY_SIZE);
+    int fd = entry->temp_name ? mkstemp(entry->temp_name) : -1;
+    if (fd >= 0 && (entry->out = fdopen(fd, "wb")) == NULL) {
+        close(fd);
+        remove(entry->temp_name);
+    }
+    if (entry->out == NULL) {
+        free(entry->temp_name);
+        entry->temp_name = NULL;
+        return false;
+    }
+    return true;
+}
+
+bool solc_cache_store_write(const unsigned char* bytes, size_t size, void* data) {
+    solc_cache_entry* entry = data;
+    if (!entry->failed && size && fwrite(bytes, size, 1, entry->out) != 1) entry->failed = true;
+    return !entry->failed;
+}
+
+bool solc_cache_store_end(solc_cache* cache, solc_cache_entry* entry, bool keep) {
+    if (entry->out == NULL) return false;
+    if (fclose(entry->out) || entry->failed) keep = false;
+    char* path = keep ? cache_path(cache, entry->key) : NULL;
+    if (path == NULL || rename(entry->temp_name, path)) {
+        remove(entry->temp_name);
+        keep = false;
+    }
+    free(path);
+    free(entry->temp_name);
+    entry->out = NULL;
+    entry->temp_name = NULL;
+    if (keep) {
+        pthread_mutex_lock(&cache->lock);
+        cache->stores++;
+        pthread_mutex_unlock(&cache->lock);
+    }
+    return keep;
+}
+
+static void hash_update(cache_hash* hash, const void* data, size_t length) {
+    // the prime is 2^88 + 0x13B, so a multiply is a shift of the low half
+    // into the high half plus a multiply by 0x13B carried across halves
+    const unsigned char* bytes = data;
+    for (size_t i = 0; i < length; i++) {
+        uint64_t low = hash->low ^ bytes[i];
+        uint64_t carry = (((low & 0xFFFFFFFF) * 0x13B >> 32) + (low >> 32) * 0x13B) >> 32;
+        hash->high = hash->high * 0x13B + carry + (low << 24);
+        hash->low = low * 0x13B;
+    }
+}
+
+static char* cache_path(solc_cache* cache, const char* name) {
+    bool entry = strcmp(name, SOLC_CACHE_TEMP) != 0;
+    size_t length = strlen(cache->dir) + 1 + strlen(name) + (entry ? strlen(SOLC_CACHE_SUFFIX) : 0);
+    char* path = malloc(length + 1);
+    if (path) sprintf(path, "%s/%s%s", cache->dir, name, entry ? SOLC_CACHE_SUFFIX : "");
+    return path;
+}
+
+static uint64_t parse_size(const char* text) {
+    char* end;
+    uint64_t size = strtoull(text, &end, 10);
+    switch (*end) {
+        case 'G': case 'g':
+            size *= 1024;
+            // fall through
+        case 'M': case 'm':
+            size *= 1024;
+            // fall through
+        case 'K': case 'k':
+            size *= 1024;
+            break;
+    }
+    return size;
+}
+
+static void evict(solc_cache* cache) {
+    DIR* dir = opendir(cache->dir);
+    if (dir == NULL) return;
+    
+    // gather every entry with its size and last use
+    cache_file* files = NULL;
+    size_t count = 0, capacity = 0;
+    uint64_t total = 0;
+    struct dirent* dirent;
+    size_t name_length = SOLC_CACHE_KEY_SIZE - 1 + strlen(SOLC_CACHE_SUFFIX);
+    while ((dirent = readdir(dir))) {
+        if (strlen(dirent->d_name) != name_length || strcmp(dirent->d_name + SOLC_CACHE_KEY_SIZE - 1, SOLC_CACHE_SUFFIX)) {
+            continue;
+        }
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            cache_file* grown = realloc(files, capacity * sizeof(*files));
+            if (grown == NULL) break;
+            files = grown;
+        }
+        struct stat file_stat;
+        char* path = malloc(strlen(cache->dir) + name_length + 2);
+        if (path == NULL) break;
+        sprintf(path, "%s/%s", cache->dir, dirent->d_name);
+        if (stat(path, &file_stat)) {
+            free(path);
+            continue;
+        }
+        files[count++] = (cache_file) { path, file_stat.st_size, file_stat.st_mtim };
+        total += file_stat.st_size;
+    }
+    closedir(dir);
+    
+    // remove the least recently used until the rest fit
+    qsort(files, count, sizeof(*files), compare_files);
+    for (size_t i = 0; i < count && total > cache->max_size; i++) {
+        if (!remove(files[i].name)) {
+            total -= files[i].size;
+            cache->evictions++;
+        }
+    }
+    for (size_t i = 0; i < count; i++) {
+        free(files[i].name);
+    }
+    free(files);
+}
+
+static int compare_files(const void* a, const void* b) {
+    const cache_file* first = a;
+    const cache_file* second = b;
+    if (first->modified.tv_sec != second->modified.tv_sec) {
+        return first->modified.tv_sec < second->modified.tv_sec ? -1 : 1;
+    }
+    return (first->modified.tv_nsec > second->modified.tv_nsec) - (first->modified.tv_nsec < second->modified.tv_nsec);
+}
@@ -0,0 +1,72 @@
+/* 
+ * File:   solccache.h
+ *
+ * Created on October 17, 2026
+ */
+
+#ifndef SOLCCACHE_H
+#define	SOLCCACHE_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "solc.h"
+
+/*
+ * An opt-in cache of compiled binaries in the directory named by
+ * SOLC_CACHE_DIR. Each entry is named by a 128-bit FNV-1a hash of the
+ * source bytes, the compiler version and the options that change the
+ * binary, so an unchanged source compiled the same way need not be parsed
+ * again. Hits touch their entry, and closing a cache that has been written
+ * to removes the least recently used entries until the rest fit in
+ * SOLC_CACHE_SIZE bytes, a number with an optional K, M or G suffix.
+ * A hit is only returned if its header is in the format it was keyed with
+ * and it passes solc_verify_ctx on ctx; anything else, such as an entry cut
+ * short by a full disk, is deleted and counted as a miss.
+ *
+ * Entries are written to a temporary file and renamed into place, so a
+ * cache can be shared by threads and by concurrent processes.
+ * solc_cache_open_dir opens a cache in dir instead, with the same size
+ * limit.
+ */
+#define SOLC_CACHE_DEFAULT_SIZE ((uint64_t) 256 * 1024 * 1024)
+#define SOLC_CACHE_KEY_SIZE 33
+
+typedef struct solc_cache {
+    char* dir;
+    uint64_t max_size;
+    size_t hits;
+    size_t misses;
+    size_t stores;
+    size_t evictions;
+    pthread_mutex_t lock;
+} solc_cache;
+
+// an entry being written; it becomes visible when it is ended, unless a
+// write to it failed
+typedef struct solc_cache_entry {
+    FILE* out;
+    bool failed;
+    char* temp_name;
+    char key[SOLC_CACHE_KEY_SIZE];
+} solc_cache_entry;
+
+bool solc_cache_open(solc_cache* cache);
+bool solc_cache_open_dir(solc_cache* cache, const char* dir);
+void solc_cache_close(solc_cache* cache);
+void solc_cache_key(const unsigned char* source, size_t size, unsigned int format, bool optimize,
+        char** disabled_passes, size_t disabled_count, char* key);
+unsigned char* solc_cache_lookup(solc_cache* cache, solc_context* ctx, const char* key, unsigned int format,
+        size_t* size);
+
+/*
+ * Stores an entry. solc_cache_store_write can be used as an emit sink, and
+ * solc_cache_store_end discards the entry unless keep is set and every
+ * write succeeded.
+ */
+bool solc_cache_store_begin(solc_cache* cache, solc_cache_entry* entry, const char* key);
+bool solc_cache_store_write(const unsigned char* bytes, size_t size, void* data);
+bool solc_cache_store_end(solc_cache* cache, solc_cache_entry* entry, bool keep);
+
+#endif	/* SOLCCACHE_H */
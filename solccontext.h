@@ -0,0 +1,170 @@
+/* 
+ * File:   solccontext.h
+ *
+ * Created on October 16, 2026
+ */
+
+#ifndef SOLCCONTEXT_H
+#define	SOLCCONTEXT_H
+
+#include <stdio.h>
+#include <sol/runtime.h>
+#include "solc.h"
+#include "solcarena.h"
+#include "solctable.h"
+#include "solcpool.h"
+#include "solcshare.h"
+
+#define SOLC_ARENA_BLOCK_SIZE (64 * 1024)
+#define SOLC_SCRATCH_SIZE 256
+#define SOLC_FRAME_STACK_SIZE 32
+#define SOLC_EMIT_BUFFER_SIZE (4 * 1024)
+#define SOLC_EMIT_FLUSH_SIZE (64 * 1024)
+#define SOLC_INDEX_MAGIC "SOLINDEX"
+#define SOLC_INDEX_MIN_CAPACITY 64
+#define SOLC_PASS_COUNT 2
+
+// identifiers synthesized by the parser or special-cased by the emitter
+typedef enum {
+    SOLC_ATOM_FREEZE,
+    SOLC_ATOM_LIST,
+    SOLC_ATOM_OBJECT_LIST,
+    SOLC_ATOM_GET,
+    SOLC_ATOM_OBJECT_GET,
+    SOLC_ATOM_OBJECT,
+    SOLC_ATOM_CREATE,
+    SOLC_ATOM_CLONE,
+    SOLC_ATOM_FUNCTION,
+    SOLC_ATOM_MACRO,
+    SOLC_ATOM_TRUE,
+    SOLC_ATOM_FALSE,
+    SOLC_ATOM_ADD,
+    SOLC_ATOM_SUBTRACT,
+    SOLC_ATOM_MULTIPLY,
+    SOLC_ATOM_DIVIDE,
+    SOLC_ATOM_COUNT
+} solc_atom_id;
+
+// growable byte buffer the emitter writes into
+typedef struct solc_buffer {
+    unsigned char* data;
+    size_t length;
+    size_t capacity;
+    // set when the memory belongs to the caller and cannot grow
+    bool fixed;
+} solc_buffer;
+
+// where a top-level form was written, for the form index
+typedef struct solc_index_entry {
+    uint64_t offset;
+    uint64_t length;
+} solc_index_entry;
+
+// nesting levels the parser has opened but not yet closed
+typedef enum {
+    SOLC_FRAME_LIST,                // ( ... )
+    SOLC_FRAME_STATEMENTS,          // [ ... ]
+    SOLC_FRAME_PARAMETERS,          // ^( ... ) ahead of a function body
+    SOLC_FRAME_FUNCTION_STATEMENTS, // ^[ ... ]
+    SOLC_FRAME_OBJECT_LITERAL,      // { ... }
+    SOLC_FRAME_FUNCTION_LITERAL,    // ^{ ... }
+    SOLC_FRAME_FREEZE               // ':' waiting for its object
+} solc_frame_kind;
+
+typedef struct solc_frame {
+    solc_frame_kind kind;
+    bool macro;
+    // offset of the opening delimiter from the start of the buffer
+    size_t open;
+    SolList list;
+    SolToken parent;
+} solc_frame;
+
+// prefixes that apply to the next object only
+typedef struct solc_modifiers {
+    bool function;
+    bool macro;
+    bool object;
+    bool expect_body;
+    SolToken parent;
+    SolList params;
+} solc_modifiers;
+
+struct solc_context {
+    // compilation-lifetime memory
+    solc_arena arena;
+    char* scratch;
+    size_t scratch_size;
+    // interned identifiers, mapping each distinct name to a shared token
+    solc_table tokens;
+    SolToken atoms[SOLC_ATOM_COUNT];
+    // error state
+    bool failed;
+    solc_diagnostic error;
+    // parser state; begin sits at line_base, column_base of the source, and
+    // while more input may follow end only lexemes starting before settled
+    // are known to be complete
+    const char* begin;
+    const char* src;
+    const char* end;
+    const char* settled;
+    bool partial;
+    size_t line_base;
+    size_t column_base;
+    solc_form_callback callback;
+    void* callback_data;
+    solc_frame* frames;
+    size_t frame_count;
+    size_t frame_capacity;
+    solc_modifiers modifiers;
+    // emitter state; output is flushed to out_sink as it fills, if set,
+    // forms are held in pending while the constant pool is being gathered,
+    // and share tracks the lists of the form being written
+    unsigned int format;
+    solc_buffer out;
+    uint64_t out_offset;
+    solc_write_callback out_sink;
+    void* out_sink_data;
+    solc_pool pool;
+    solc_share share;
+    SolList pending;
+    solc_index_entry* index;
+    size_t index_count;
+    size_t index_capacity;
+    // optimizer state; disabled_passes has a bit set for each pass skipped
+    bool optimize;
+    unsigned int disabled_passes;
+    solc_pass_stats pass_stats[SOLC_PASS_COUNT];
+    solc_pass_stats* pass;
+};
+
+// fails the call on ctx and returns NULL when out of memory
+char* solc_context_scratch(solc_context* ctx, size_t size);
+
+void solc_begin(solc_context* ctx);
+void solc_error(solc_context* ctx, const char* stage, const char* position, const char* format, ...);
+void solc_exit_on_error(solc_context* ctx);
+void solc_advance_position(solc_context* ctx, const char* to);
+
+bool solc_parse_forms(solc_context* ctx, const char* source, size_t length, solc_form_callback callback, void* data);
+void solc_parse_start(solc_context* ctx, solc_form_callback callback, void* data);
+bool solc_parse_resume(solc_context* ctx, const char* buffer, size_t from, size_t length, bool partial);
+void solc_parse_unwind(solc_context* ctx);
+
+bool solc_decode_forms(solc_context* ctx, const unsigned char* image, size_t size, solc_form_callback callback, void* data);
+
+void solc_emit_begin(solc_context* ctx, solc_write_callback sink, void* data);
+void solc_emit_form(solc_context* ctx, SolObject form);
+bool solc_emit_end(solc_context* ctx);
+bool solc_write_file(const unsigned char* bytes, size_t size, void* data);
+
+// fails the call on ctx and returns NULL when out of memory; solc_atom
+// still returns a token, though not an interned one
+SolToken solc_intern(solc_context* ctx, const char* identifier, size_t length);
+SolToken solc_atom(solc_context* ctx, solc_atom_id atom);
+bool solc_is_atom(solc_context* ctx, SolToken token, solc_atom_id atom);
+
+SolObject solc_optimize_form(solc_context* ctx, SolObject form);
+
+#endif	/* SOLCCONTEXT_H */
+
@@ -0,0 +1,605 @@
+#include "solc.h"
+#include "solccontext.h"
+
+#include <math.h>
+#include <string.h>
+#include <ctype.h>
+
+// index trailer: entries, a 64-bit count, then the magic
+#define SOLC_INDEX_ENTRY_SIZE 16
+#define SOLC_INDEX_FOOTER_SIZE 16
+
+#define decode_error(d, ...) solc_error((d)->ctx, "decoding binary", NULL, __VA_ARGS__)
+#define offset(d) ((size_t) ((d)->pos - (d)->image))
+#define listing(d, ...) do { if ((d)->listing) fprintf((d)->listing, __VA_ARGS__); } while (0)
+
+// a list being filled, and how many of its items are still to come
+typedef struct solc_decode_frame {
+    SolList list;
+    uint64_t remaining;
+    size_t id;
+} solc_decode_frame;
+
+// a list of the current form that later lists may refer back to
+typedef struct solc_decode_shared {
+    SolList list;
+    bool open;
+} solc_decode_shared;
+
+typedef struct solc_decode_constant {
+    unsigned char kind;
+    const unsigned char* bytes;
+    size_t length;
+    SolObject object;
+} solc_decode_constant;
+
+/*
+ * Decoding walks the image once, checking every read against the end of the
+ * buffer. It can build the forms, only validate them, or print a listing of
+ * them along the way.
+ */
+typedef struct solc_decoder {
+    solc_context* ctx;
+    const unsigned char* image;
+    const unsigned char* pos;
+    const unsigned char* end;
+    unsigned int format;
+    bool build;
+    FILE* listing;
+    solc_form_callback callback;
+    void* callback_data;
+    // the index trailer, if the image has one
+    const unsigned char* index;
+    size_t index_count;
+    size_t form;
+    const unsigned char* form_start;
+    solc_decode_constant* pool;
+    size_t pool_count;
+    solc_decode_frame* frames;
+    size_t frame_count;
+    size_t frame_capacity;
+    solc_decode_shared* shared;
+    size_t shared_count;
+    size_t shared_capacity;
+} solc_decoder;
+
+static bool decode_image(solc_decoder* d);
+static bool read_header(solc_decoder* d);
+static bool read_pool(solc_decoder* d);
+static void read_object(solc_decoder* d);
+static void read_list(solc_decoder* d);
+static void read_text(solc_decoder* d, unsigned char opcode);
+static void read_number(solc_decoder* d, unsigned char opcode);
+static void read_constant(solc_decoder* d);
+static void read_shared(solc_decoder* d);
+static SolObject make_text(solc_decoder* d, unsigned char kind, const unsigned char* bytes, size_t length);
+static void decoded(solc_decoder* d, SolObject object);
+static void finish_form(solc_decoder* d, SolObject form);
+static bool check_index(solc_decoder* d);
+static void decoder_release(solc_decoder* d);
+
+static bool need(solc_decoder* d, size_t size);
+static bool read_length(solc_decoder* d, uint64_t* length);
+static bool read_varint(solc_decoder* d, uint64_t* value);
+static uint64_t get_u64(const unsigned char* bytes);
+static void print_text(FILE* out, const unsigned char* bytes, size_t length);
+static void collect_form(SolObject form, void* data);
+
+SolList solc_decode(const unsigned char* image, size_t size) {
+    solc_context* ctx = solc_context_create();
+    SolList ret = solc_decode_ctx(ctx, image, size);
+    solc_exit_on_error(ctx);
+    solc_context_destroy(ctx);
+    return ret;
+}
+
+bool solc_disassemble(const unsigned char* image, size_t size, FILE* out) {
+    solc_context* ctx = solc_context_create();
+    bool ret = solc_disassemble_ctx(ctx, image, size, out);
+    solc_exit_on_error(ctx);
+    solc_context_destroy(ctx);
+    return ret;
+}
+
+SolList solc_decode_ctx(solc_context* ctx, const unsigned char* image, size_t size) {
+    solc_begin(ctx);
+    SolList out = (SolList) sol_obj_retain((SolObject) sol_list_create(false));
+    if (!solc_decode_forms(ctx, image, size, collect_form, out)) {
+        sol_obj_release((SolObject) out);
+        return NULL;
+    }
+    return out;
+}
+
+bool solc_decode_forms(solc_context* ctx, const unsigned char* image, size_t size, solc_form_callback callback, void* data) {
+    solc_decoder d = {
+        .ctx = ctx, .image = image, .pos = image, .end = image + size,
+        .build = true, .callback = callback, .callback_data = data
+    };
+    return decode_image(&d);
+}
+
+bool solc_verify_ctx(solc_context* ctx, const unsigned char* image, size_t size) {
+    solc_begin(ctx);
+    solc_decoder d = { .ctx = ctx, .image = image, .pos = image, .end = image + size };
+    return decode_image(&d);
+}
+
+bool solc_disassemble_ctx(solc_context* ctx, const unsigned char* image, size_t size, FILE* out) {
+    solc_begin(ctx);
+    solc_decoder d = { .ctx = ctx, .image = image, .pos = image, .end = image + size, .listing = out };
+    return decode_image(&d);
+}
+
+size_t solc_index_count(const unsigned char* image, size_t size) {
+    if (size < 6 + SOLC_INDEX_FOOTER_SIZE || memcmp(image, "SOLBIN", 6)
+            || memcmp(image + size - 8, SOLC_INDEX_MAGIC, 8)) {
+        return 0;
+    }
+    uint64_t count = get_u64(image + size - SOLC_INDEX_FOOTER_SIZE);
+    if (count > (size - 6 - SOLC_INDEX_FOOTER_SIZE) / SOLC_INDEX_ENTRY_SIZE) return 0;
+    return count;
+}
+
+bool solc_index_form(const unsigned char* image, size_t size, size_t n, size_t* offset, size_t* length) {
+    size_t count = solc_index_count(image, size);
+    if (n >= count) return false;
+    // forms must lie between the header and the index itself
+    size_t index_start = size - SOLC_INDEX_FOOTER_SIZE - count * SOLC_INDEX_ENTRY_SIZE;
+    const unsigned char* entry = image + index_start + n * SOLC_INDEX_ENTRY_SIZE;
+    uint64_t form_offset = get_u64(entry);
+    uint64_t form_length = get_u64(entry + 8);
+    if (form_offset < 6 || form_offset > index_start || form_length > index_start - form_offset) {
+        return false;
+    }
+    *offset = form_offset;
+    *length = form_length;
+    return true;
+}
+
+static bool decode_image(solc_decoder* d) {
+    if (read_header(d) && read_pool(d)) {
+        while (!d->ctx->failed) {
+            if (!need(d, 1)) break;
+            // a zero where a form would start ends the image
+            if (d->frame_count == 0 && *d->pos == 0x0) {
+                listing(d, "%08zx  end\n", offset(d));
+                d->pos++;
+                check_index(d);
+                break;
+            }
+            if (d->frame_count == 0) {
+                d->form_start = d->pos;
+                d->shared_count = 0;
+                listing(d, "form %zu\n", d->form);
+            }
+            read_object(d);
+        }
+    }
+    decoder_release(d);
+    return !d->ctx->failed;
+}
+
+static bool read_header(solc_decoder* d) {
+    if (!need(d, 6) || memcmp(d->pos, "SOLBIN", 6)) {
+        decode_error(d, "missing SOLBIN magic");
+        return false;
+    }
+    d->pos += 6;
+    if (d->pos < d->end && *d->pos == 0xFE) {
+        if (!need(d, 3)) return false;
+        if (d->pos[1] != 0x2) {
+            decode_error(d, "unsupported SOLBIN version %u", d->pos[1]);
+            return false;
+        }
+        d->format = d->pos[2];
+        if (d->format & ~SOLC_FORMAT_ALL) {
+            decode_error(d, "unsupported format options 0x%02x", d->format);
+            return false;
+        }
+        d->pos += 3;
+    }
+    listing(d, "SOLBIN version %d%s%s%s%s%s\n", d->format ? 2 : 1,
+            d->format & SOLC_FORMAT_POOL ? " pool" : "", d->format & SOLC_FORMAT_INDEX ? " index" : "",
+            d->format & SOLC_FORMAT_NUMBERS ? " numbers" : "", d->format & SOLC_FORMAT_VARINT ? " varint" : "",
+            d->format & SOLC_FORMAT_SHARE ? " share" : "");
+    
+    // the index sits at the very end, so forms stop short of it
+    if (d->format & SOLC_FORMAT_INDEX) {
+        d->index_count = solc_index_count(d->image, d->end - d->image);
+        size_t trailer = SOLC_INDEX_FOOTER_SIZE + d->index_count * SOLC_INDEX_ENTRY_SIZE;
+        if (d->index_count == 0 && (d->end - d->image < SOLC_INDEX_FOOTER_SIZE
+                || memcmp(d->end - 8, SOLC_INDEX_MAGIC, 8))) {
+            decode_error(d, "missing form index");
+            return false;
+        }
+        if ((size_t) (d->end - d->pos) < trailer) {
+            decode_error(d, "form index overlaps the header");
+            return false;
+        }
+        d->end -= trailer;
+        d->index = d->end;
+    }
+    return true;
+}
+
+static bool read_pool(solc_decoder* d) {
+    if (!(d->format & SOLC_FORMAT_POOL)) return true;
+    uint64_t count;
+    if (!read_varint(d, &count)) return false;
+    // every entry takes at least two bytes
+    if (count > (size_t) (d->end - d->pos) / 2) {
+        decode_error(d, "constant pool of %llu entries exceeds the image", (unsigned long long) count);
+        return false;
+    }
+    listing(d, "pool %llu\n", (unsigned long long) count);
+    d->pool = calloc(count ? count : 1, sizeof(*d->pool));
+    if (d->pool == NULL) {
+        decode_error(d, "out of memory");
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        size_t at = offset(d);
+        uint64_t length;
+        if (!need(d, 1)) return false;
+        unsigned char kind = *d->pos++;
+        if (kind != 0x2 && kind != 0x4) {
+            decode_error(d, "invalid constant kind 0x%02x at offset %zu", kind, at);
+            return false;
+        }
+        if (!read_length(d, &length) || !need(d, length)) return false;
+        if (memchr(d->pos, '\0', length)) {
+            decode_error(d, "NUL byte in constant at offset %zu", at);
+            return false;
+        }
+        solc_decode_constant* constant = &d->pool[d->pool_count++];
+        *constant = (solc_decode_constant) { kind, d->pos, length, NULL };
+        if (d->build && (constant->object = make_text(d, kind, d->pos, length)) == NULL) return false;
+        if (d->listing) {
+            fprintf(d->listing, "%08zx  #%zu %s ", at, i, kind == 0x2 ? "token" : "string");
+            print_text(d->listing, d->pos, length);
+            fputc('\n', d->listing);
+        }
+        d->pos += length;
+    }
+    return true;
+}
+
+static void read_object(solc_decoder* d) {
+    if (d->listing) fprintf(d->listing, "%08zx  %*s", offset(d), (int) (2 * d->frame_count), "");
+    unsigned char opcode = *d->pos++;
+    switch (opcode) {
+        case 0x1:
+            read_list(d);
+            break;
+        case 0x2: case 0x4:
+            read_text(d, opcode);
+            break;
+        case 0x3: case 0x8: case 0x9: case 0xA:
+            read_number(d, opcode);
+            break;
+        case 0x5: {
+            if (!need(d, 1)) return;
+            unsigned char value = *d->pos++;
+            if (value > 1) {
+                decode_error(d, "invalid boolean %u at offset %zu", value, offset(d) - 1);
+                return;
+            }
+            listing(d, "bool %s\n", value ? "true" : "false");
+            decoded(d, d->build ? sol_obj_retain((SolObject) solc_atom(d->ctx, value ? SOLC_ATOM_TRUE : SOLC_ATOM_FALSE)) : NULL);
+            break;
+        }
+        case 0x7:
+            read_constant(d);
+            break;
+        case 0xB:
+            read_shared(d);
+            break;
+        default:
+            decode_error(d, "invalid opcode 0x%02x at offset %zu", opcode, offset(d) - 1);
+    }
+}
+
+static void read_list(solc_decoder* d) {
+    uint64_t length;
+    if (!need(d, 1)) return;
+    unsigned char object_mode = *d->pos++;
+    if (object_mode > 1) {
+        decode_error(d, "invalid list mode %u at offset %zu", object_mode, offset(d) - 1);
+        return;
+    }
+    if (!read_length(d, &length)) return;
+    // every item takes at least two bytes
+    if (length > (size_t) (d->end - d->pos) / 2) {
+        decode_error(d, "list of %llu items exceeds the image", (unsigned long long) length);
+        return;
+    }
+    SolList list = d->build ? (SolList) sol_obj_retain((SolObject) sol_list_create(object_mode)) : NULL;
+    
+    // lists that can be referred back to are numbered as they start
+    size_t id = d->shared_count;
+    if (d->format & SOLC_FORMAT_SHARE) {
+        if (d->shared_count == d->shared_capacity) {
+            size_t capacity = d->shared_capacity ? d->shared_capacity * 2 : SOLC_FRAME_STACK_SIZE;
+            solc_decode_shared* shared = realloc(d->shared, capacity * sizeof(*shared));
+            if (shared == NULL) {
+                if (list) sol_obj_release((SolObject) list);
+                decode_error(d, "out of memory");
+                return;
+            }
+            d->shared = shared;
+            d->shared_capacity = capacity;
+        }
+        d->shared[d->shared_count++] = (solc_decode_shared) { list, length > 0 };
+        listing(d, "%slist %llu #%zu\n", object_mode ? "@" : "", (unsigned long long) length, id);
+    } else {
+        listing(d, "%slist %llu\n", object_mode ? "@" : "", (unsigned long long) length);
+    }
+    if (length == 0) {
+        decoded(d, (SolObject) list);
+        return;
+    }
+    if (d->frame_count == d->frame_capacity) {
+        size_t capacity = d->frame_capacity ? d->frame_capacity * 2 : SOLC_FRAME_STACK_SIZE;
+        solc_decode_frame* frames = realloc(d->frames, capacity * sizeof(*frames));
+        if (frames == NULL) {
+            if (list) sol_obj_release((SolObject) list);
+            decode_error(d, "out of memory");
+            return;
+        }
+        d->frames = frames;
+        d->frame_capacity = capacity;
+    }
+    d->frames[d->frame_count++] = (solc_decode_frame) { list, length, id };
+}
+
+static void read_text(solc_decoder* d, unsigned char opcode) {
+    size_t at = offset(d) - 1;
+    uint64_t length;
+    if (!read_length(d, &length) || !need(d, length)) return;
+    if (memchr(d->pos, '\0', length)) {
+        decode_error(d, "NUL byte in %s at offset %zu", opcode == 0x2 ? "token" : "string", at);
+        return;
+    }
+    if (d->listing) {
+        fprintf(d->listing, "%s ", opcode == 0x2 ? "token" : "string");
+        print_text(d->listing, d->pos, length);
+        fputc('\n', d->listing);
+    }
+    SolObject object = d->build ? make_text(d, opcode, d->pos, length) : NULL;
+    if (d->build && object == NULL) return;
+    d->pos += length;
+    decoded(d, object);
+}
+
+static void read_number(solc_decoder* d, unsigned char opcode) {
+    size_t at = offset(d) - 1;
+    if (opcode != 0x3 && !(d->format & SOLC_FORMAT_NUMBERS)) {
+        decode_error(d, "invalid opcode 0x%02x at offset %zu", opcode, at);
+        return;
+    }
+    double value;
+    switch (opcode) {
+        case 0x3: {
+            // significand scaled by 2^52 and a binary exponent
+            if (!need(d, 12)) return;
+            int64_t significand = (int64_t) get_u64(d->pos);
+            int32_t exponent = (int32_t) (get_u64(d->pos + 4) & 0xFFFFFFFF);
+            value = ldexp((double) significand, exponent - 52);
+            d->pos += 12;
+            break;
+        }
+        case 0x8:
+            if (!need(d, 1)) return;
+            value = (int8_t) *d->pos++;
+            break;
+        case 0x9: {
+            uint64_t zigzag;
+            if (!read_varint(d, &zigzag)) return;
+            int64_t integer = (int64_t) (zigzag >> 1) ^ -(int64_t) (zigzag & 1);
+            if (integer > (INT64_C(1) << 53) || integer < -(INT64_C(1) << 53)) {
+                decode_error(d, "integer out of range at offset %zu", at);
+                return;
+            }
+            value = integer;
+            break;
+        }
+        default: {
+            if (!need(d, 8)) return;
+            uint64_t bits = get_u64(d->pos);
+            memcpy(&value, &bits, sizeof(value));
+            d->pos += 8;
+        }
+    }
+    listing(d, "number %.17g\n", value);
+    decoded(d, d->build ? sol_obj_retain((SolObject) sol_num_create(value)) : NULL);
+}
+
+static void read_constant(solc_decoder* d) {
+    size_t at = offset(d) - 1;
+    uint64_t index;
+    if (!(d->format & SOLC_FORMAT_POOL)) {
+        decode_error(d, "invalid opcode 0x07 at offset %zu", at);
+        return;
+    }
+    if (!read_varint(d, &index)) return;
+    if (index >= d->pool_count) {
+        decode_error(d, "constant #%llu out of range at offset %zu", (unsigned long long) index, at);
+        return;
+    }
+    solc_decode_constant* constant = &d->pool[index];
+    if (d->listing) {
+        fprintf(d->listing, "const #%llu %s ", (unsigned long long) index, constant->kind == 0x2 ? "token" : "string");
+        print_text(d->listing, constant->bytes, constant->length);
+        fputc('\n', d->listing);
+    }
+    decoded(d, d->build ? sol_obj_retain(constant->object) : NULL);
+}
+
+static void read_shared(solc_decoder* d) {
+    size_t at = offset(d) - 1;
+    uint64_t id;
+    if (!(d->format & SOLC_FORMAT_SHARE)) {
+        decode_error(d, "invalid opcode 0x0b at offset %zu", at);
+        return;
+    }
+    if (!read_varint(d, &id)) return;
+    // only finished lists of the same form can be referred to
+    if (id >= d->shared_count || d->shared[id].open) {
+        decode_error(d, "list #%llu out of range at offset %zu", (unsigned long long) id, at);
+        return;
+    }
+    listing(d, "ref #%llu\n", (unsigned long long) id);
+    decoded(d, d->build ? sol_obj_retain((SolObject) d->shared[id].list) : NULL);
+}
+
+static SolObject make_text(solc_decoder* d, unsigned char kind, const unsigned char* bytes, size_t length) {
+    if (kind == 0x2) {
+        SolToken token = solc_intern(d->ctx, (const char*) bytes, length);
+        return token ? sol_obj_retain((SolObject) token) : NULL;
+    }
+    char* value = solc_context_scratch(d->ctx, length + 1);
+    if (value == NULL) return NULL;
+    memcpy(value, bytes, length);
+    value[length] = '\0';
+    return sol_obj_retain((SolObject) sol_string_create(value));
+}
+
+static void decoded(solc_decoder* d, SolObject object) {
+    // add the object to the innermost list; lists that are now full are
+    // added to their parents in turn
+    while (d->frame_count > 0) {
+        solc_decode_frame* frame = &d->frames[d->frame_count - 1];
+        if (object) {
+            sol_list_add_obj(frame->list, object);
+            sol_obj_release(object);
+        }
+        if (--frame->remaining > 0) return;
+        object = (SolObject) frame->list;
+        if (d->format & SOLC_FORMAT_SHARE) d->shared[frame->id].open = false;
+        d->frame_count--;
+    }
+    finish_form(d, object);
+}
+
+static void finish_form(solc_decoder* d, SolObject form) {
+    // forms have to match their index entries exactly
+    if (d->index) {
+        size_t start = d->form_start - d->image;
+        const unsigned char* entry = d->index + d->form * SOLC_INDEX_ENTRY_SIZE;
+        if (d->form >= d->index_count || get_u64(entry) != start || get_u64(entry + 8) != offset(d) - start) {
+            if (form) sol_obj_release(form);
+            decode_error(d, "form %zu does not match its index entry", d->form);
+            return;
+        }
+    }
+    d->form++;
+    if (form) {
+        d->callback(form, d->callback_data);
+        sol_obj_release(form);
+    }
+}
+
+static bool check_index(solc_decoder* d) {
+    if (d->index) {
+        if (d->form != d->index_count) {
+            decode_error(d, "index lists %zu forms but the image has %zu", d->index_count, d->form);
+            return false;
+        }
+        listing(d, "%08zx  index %zu\n", offset(d), d->index_count);
+        d->pos = d->end = d->index + d->index_count * SOLC_INDEX_ENTRY_SIZE + SOLC_INDEX_FOOTER_SIZE;
+    }
+    if (d->pos != d->end) {
+        decode_error(d, "%zu trailing bytes after the end of the image", (size_t) (d->end - d->pos));
+        return false;
+    }
+    return true;
+}
+
+static void decoder_release(solc_decoder* d) {
+    while (d->frame_count > 0) {
+        solc_decode_frame* frame = &d->frames[--d->frame_count];
+        if (frame->list) sol_obj_release((SolObject) frame->list);
+    }
+    for (size_t i = 0; i < d->pool_count; i++) {
+        if (d->pool[i].object) sol_obj_release(d->pool[i].object);
+    }
+    free(d->frames);
+    free(d->shared);
+    free(d->pool);
+}
+
+static bool need(solc_decoder* d, size_t size) {
+    if ((size_t) (d->end - d->pos) < size) {
+        decode_error(d, "unexpected end of image at offset %zu", offset(d));
+        return false;
+    }
+    return true;
+}
+
+static bool read_length(solc_decoder* d, uint64_t* length) {
+    if (d->format & SOLC_FORMAT_VARINT) return read_varint(d, length);
+    if (!need(d, 1)) return false;
+    // the top nibble selects how many bytes the length takes
+    size_t size;
+    switch (*d->pos >> 4) {
+        case 0x1: size = 1; break;
+        case 0x2: size = 2; break;
+        case 0x3: size = 4; break;
+        case 0x4: size = 8; break;
+        default:
+            decode_error(d, "invalid length tag 0x%02x at offset %zu", *d->pos, offset(d));
+            return false;
+    }
+    if (!need(d, size)) return false;
+    uint64_t value = *d->pos & 0xF;
+    for (size_t i = 1; i < size; i++) {
+        value = (value << 8) | d->pos[i];
+    }
+    d->pos += size;
+    *length = value;
+    return true;
+}
+
+static bool read_varint(solc_decoder* d, uint64_t* value) {
+    // unsigned LEB128 of at most ten bytes
+    uint64_t result = 0;
+    for (unsigned int shift = 0; shift < 64; shift += 7) {
+        if (!need(d, 1)) return false;
+        unsigned char byte = *d->pos++;
+        result |= (uint64_t) (byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    decode_error(d, "varint too long at offset %zu", offset(d));
+    return false;
+}
+
+static uint64_t get_u64(const unsigned char* bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) {
+        value = (value << 8) | bytes[i];
+    }
+    return value;
+}
+
+static void print_text(FILE* out, const unsigned char* bytes, size_t length) {
+    fputc('"', out);
+    for (size_t i = 0; i < length; i++) {
+        unsigned char c = bytes[i];
+        if (c == '"' || c == '\\') {
+            fprintf(out, "\\%c", c);
+        } else if (isprint(c)) {
+            fputc(c, out);
+        } else {
+            fprintf(out, "\\x%02x", c);
+        }
+    }
+    fputc('"', out);
+}
+
+static void collect_form(SolObject form, void* data) {
+    sol_list_add_obj((SolList) data, form);
+}
@@ -0,0 +1,158 @@
+#include <string.h>
+#include "solcelf.h"
+
+#define ELF_HEADER_SIZE 64
+#define ELF_SECTION_HEADER_SIZE 64
+#define ELF_SYMBOL_SIZE 24
+
+#define ELF_MACHINE_X86_64 62
+#define ELF_MACHINE_AARCH64 183
+
+#define ELF_SECTION_PROGBITS 1
+#define ELF_SECTION_SYMTAB 2
+#define ELF_SECTION_STRTAB 3
+#define ELF_FLAG_ALLOC 0x2
+
+// sections in the order their headers are written
+enum {
+    SECTION_NULL,
+    SECTION_RODATA,
+    SECTION_SYMTAB,
+    SECTION_STRTAB,
+    SECTION_NOTE_STACK,
+    SECTION_SHSTRTAB,
+    SECTION_COUNT
+};
+
+// section names, each NUL-terminated, at the offsets given below
+static const char shstrtab[] = "\0.rodata\0.symtab\0.strtab\0.note.GNU-stack\0.shstrtab";
+static const uint32_t shstrtab_names[SECTION_COUNT] = { 0, 1, 9, 17, 25, 41 };
+
+typedef struct elf_section {
+    uint32_t name;
+    uint32_t type;
+    uint64_t flags;
+    uint64_t offset;
+    uint64_t size;
+    uint32_t link;
+    uint32_t info;
+    uint64_t align;
+    uint64_t entsize;
+} elf_section;
+
+static bool write_zeros(FILE* out, size_t count);
+static bool write_section(FILE* out, const elf_section* section);
+static void put_u16(unsigned char* p, uint16_t value);
+static void put_u32(unsigned char* p, uint32_t value);
+static void put_u64(unsigned char* p, uint64_t value);
+
+bool solc_elf_begin(solc_elf_writer* elf, FILE* out, solc_elf_machine machine, const char* symbol) {
+    elf->out = out;
+    elf->machine = machine;
+    elf->symbol = symbol;
+    elf->size = 0;
+    // the header is filled in at the end; the binary follows it directly
+    return write_zeros(out, ELF_HEADER_SIZE);
+}
+
+bool solc_elf_write(const unsigned char* bytes, size_t size, void* data) {
+    solc_elf_writer* elf = data;
+    if (size && fwrite(bytes, size, 1, elf->out) != 1) return false;
+    elf->size += size;
+    return true;
+}
+
+bool solc_elf_end(solc_elf_writer* elf) {
+    FILE* out = elf->out;
+    size_t symbol_length = strlen(elf->symbol);
+    
+    // the symbol table holds the null symbol, one for the section, and the
+    // binary itself, which is the only global
+    uint64_t symtab_offset = (ELF_HEADER_SIZE + elf->size + 7) & ~(uint64_t) 7;
+    unsigned char symbols[3 * ELF_SYMBOL_SIZE] = { 0 };
+    unsigned char* section_symbol = symbols + ELF_SYMBOL_SIZE;
+    section_symbol[4] = 0x03;                   // STB_LOCAL, STT_SECTION
+    put_u16(section_symbol + 6, SECTION_RODATA);
+    unsigned char* data_symbol = symbols + 2 * ELF_SYMBOL_SIZE;
+    put_u32(data_symbol, 1);
+    data_symbol[4] = 0x11;                      // STB_GLOBAL, STT_OBJECT
+    put_u16(data_symbol + 6, SECTION_RODATA);
+    put_u64(data_symbol + 16, elf->size);
+    
+    uint64_t strtab_offset = symtab_offset + sizeof(symbols);
+    uint64_t strtab_size = symbol_length + 2;
+    uint64_t shstrtab_offset = strtab_offset + strtab_size;
+    uint64_t headers_offset = (shstrtab_offset + sizeof(shstrtab) + 7) & ~(uint64_t) 7;
+    if (!write_zeros(out, symtab_offset - ELF_HEADER_SIZE - elf->size)
+            || fwrite(symbols, sizeof(symbols), 1, out) != 1
+            || !write_zeros(out, 1) || fwrite(elf->symbol, symbol_length + 1, 1, out) != 1
+            || fwrite(shstrtab, sizeof(shstrtab), 1, out) != 1
+            || !write_zeros(out, headers_offset - shstrtab_offset - sizeof(shstrtab))) {
+        return false;
+    }
+    
+    elf_section sections[SECTION_COUNT] = {
+        [SECTION_RODATA] = { .type = ELF_SECTION_PROGBITS, .flags = ELF_FLAG_ALLOC,
+                .offset = ELF_HEADER_SIZE, .size = elf->size, .align = 16 },
+        [SECTION_SYMTAB] = { .type = ELF_SECTION_SYMTAB, .offset = symtab_offset, .size = sizeof(symbols),
+                .link = SECTION_STRTAB, .info = 2, .align = 8, .entsize = ELF_SYMBOL_SIZE },
+        [SECTION_STRTAB] = { .type = ELF_SECTION_STRTAB, .offset = strtab_offset, .size = strtab_size,
+                .align = 1 },
+        [SECTION_NOTE_STACK] = { .type = ELF_SECTION_PROGBITS, .offset = shstrtab_offset, .align = 1 },
+        [SECTION_SHSTRTAB] = { .type = ELF_SECTION_STRTAB, .offset = shstrtab_offset, .size = sizeof(shstrtab),
+                .align = 1 }
+    };
+    for (int i = 0; i < SECTION_COUNT; i++) {
+        sections[i].name = shstrtab_names[i];
+        if (!write_section(out, &sections[i])) return false;
+    }
+    
+    // go back for the ELF header
+    unsigned char header[ELF_HEADER_SIZE] = { 0x7F, 'E', 'L', 'F', 2, 1, 1 };
+    put_u16(header + 16, 1);                    // ET_REL
+    put_u16(header + 18, elf->machine == SOLC_ELF_AARCH64 ? ELF_MACHINE_AARCH64 : ELF_MACHINE_X86_64);
+    put_u32(header + 20, 1);
+    put_u64(header + 40, headers_offset);
+    put_u16(header + 52, ELF_HEADER_SIZE);
+    put_u16(header + 58, ELF_SECTION_HEADER_SIZE);
+    put_u16(header + 60, SECTION_COUNT);
+    put_u16(header + 62, SECTION_SHSTRTAB);
+    if (fseek(out, 0, SEEK_SET) || fwrite(header, sizeof(header), 1, out) != 1) return false;
+    return fseek(out, 0, SEEK_END) == 0 && !ferror(out);
+}
+
+static bool write_zeros(FILE* out, size_t count) {
+    static const unsigned char zeros[ELF_HEADER_SIZE];
+    return count == 0 || fwrite(zeros, count, 1, out) == 1;
+}
+
+static bool write_section(FILE* out, const elf_section* section) {
+    unsigned char bytes[ELF_SECTION_HEADER_SIZE];
+    put_u32(bytes, section->name);
+    put_u32(bytes + 4, section->type);
+    put_u64(bytes + 8, section->flags);
+    put_u64(bytes + 16, 0);
+    put_u64(bytes + 24, section->offset);
+    put_u64(bytes + 32, section->size);
+    put_u32(bytes + 40, section->link);
+    put_u32(bytes + 44, section->info);
+    put_u64(bytes + 48, section->align);
+    put_u64(bytes + 56, section->entsize);
+    return fwrite(bytes, sizeof(bytes), 1, out) == 1;
+}
+
+// ELF fields are little-endian on both supported machines
+static void put_u16(unsigned char* p, uint16_t value) {
+    p[0] = value;
+    p[1] = value >> 8;
+}
+
+static void put_u32(unsigned char* p, uint32_t value) {
+    put_u16(p, value);
+    put_u16(p + 2, value >> 16);
+}
+
+static void put_u64(unsigned char* p, uint64_t value) {
+    put_u32(p, value);
+    put_u32(p + 4, value >> 32);
+}
@@ -0,0 +1,43 @@
+/* 
+ * File:   solcelf.h
+ *
+ * Created on October 16, 2026
+ */
+
+#ifndef SOLCELF_H
+#define	SOLCELF_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Writes a relocatable ELF64 object holding the compiled binary in .rodata
+ * under a global symbol, so that it can be linked straight into a program
+ * without compiling a C array. Like the C generator it can be used as an
+ * emit sink; the output must be seekable, since the ELF header is written
+ * last once the size of the binary is known.
+ */
+typedef enum {
+    SOLC_ELF_X86_64,
+    SOLC_ELF_AARCH64
+} solc_elf_machine;
+
+#if defined(__aarch64__)
+#define SOLC_ELF_HOST SOLC_ELF_AARCH64
+#else
+#define SOLC_ELF_HOST SOLC_ELF_X86_64
+#endif
+
+typedef struct solc_elf_writer {
+    FILE* out;
+    solc_elf_machine machine;
+    const char* symbol;
+    uint64_t size;
+} solc_elf_writer;
+
+bool solc_elf_begin(solc_elf_writer* elf, FILE* out, solc_elf_machine machine, const char* symbol);
+bool solc_elf_write(const unsigned char* bytes, size_t size, void* data);
+bool solc_elf_end(solc_elf_writer* elf);
+
+#endif	/* SOLCELF_H */
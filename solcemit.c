@@ -1,171 +1,487 @@
 
 #include "solc.h"
+#include "solccontext.h"
 
 #include <math.h>
+#include <string.h>
 #include <float.h>
-#include <arpa/inet.h>
+#include <errno.h>
+#include <unistd.h>
 
-#define write(value, size) fwrite(&(value), (size), 1, out)
-#define writes(value, size) fwrite((value), (size), 1, out)
-#define writec(value) fputc((value), out)
+// 2^53; every integer up to this magnitude is exactly representable
+#define SOLC_MAX_EXACT_INTEGER 9007199254740992.0
 
-static SolList src;
-static FILE* out;
+#define emit_error(ctx, ...) solc_error((ctx), "emitting binary", NULL, __VA_ARGS__)
 
-uint64_t htonll(uint64_t value);
-uint64_t ntohll(uint64_t value);
-void write_length(uint64_t length);
+static void emit_forms(solc_context* ctx, SolList source);
+static void write_form(solc_context* ctx, SolObject form);
+static bool grow_output(solc_context* ctx, size_t size);
+static void flush_output(solc_context* ctx);
+static bool write_fd(const unsigned char* bytes, size_t size, void* data);
 
-void write_object(SolObject obj);
-void write_list(SolList list);
-void write_token(SolToken token);
-void write_string(SolString string);
-void write_number(SolNumber number);
+static inline void put_byte(solc_context* ctx, unsigned char byte) {
+    if (ctx->out.length < ctx->out.capacity || grow_output(ctx, 1)) {
+        ctx->out.data[ctx->out.length++] = byte;
+    }
+}
 
-unsigned char* solc_emit(SolList source, off_t* size) {
-    src = source;
-    
-    // create temporary file for writing
-    out = tmpfile();
-    
-    writec('S'); writec('O'); writec('L'); writec('B'); writec('I'); writec('N');
-    SOL_LIST_ITR(source, current, i) {
-        write_object(current->value);
+static inline void put_bytes(solc_context* ctx, const void* bytes, size_t size) {
+    if (ctx->out.capacity - ctx->out.length >= size || grow_output(ctx, size)) {
+        memcpy(ctx->out.data + ctx->out.length, bytes, size);
+        ctx->out.length += size;
     }
-    writec(0x0);
-    
-    // read temporary file into buffer
-    fseek(out, 0, SEEK_END);
-    off_t length = ftell(out);
-    unsigned char* buffer = malloc(length);
-    fseek(out, 0, SEEK_SET);
-    if (fread(buffer, length, 1, out) != 1) {
-        fprintf(stderr, "solc: error while emitting data: error while reading compiled data to buffer\n");
-        exit(EXIT_FAILURE);
+}
+
+// multi-byte values are written big-endian
+static inline void put_u16(solc_context* ctx, uint16_t value) {
+    unsigned char bytes[2] = { value >> 8, value };
+    put_bytes(ctx, bytes, sizeof(bytes));
+}
+
+static inline void put_u32(solc_context* ctx, uint32_t value) {
+    unsigned char bytes[4] = { value >> 24, value >> 16, value >> 8, value };
+    put_bytes(ctx, bytes, sizeof(bytes));
+}
+
+static inline void put_u64(solc_context* ctx, uint64_t value) {
+    put_u32(ctx, value >> 32);
+    put_u32(ctx, value);
+}
+
+// unsigned LEB128: seven bits per byte, low bits first
+static inline void put_varint(solc_context* ctx, uint64_t value) {
+    while (value >= 0x80) {
+        put_byte(ctx, (value & 0x7F) | 0x80);
+        value >>= 7;
     }
+    put_byte(ctx, value);
+}
+
+static void write_header(solc_context* ctx);
+static void write_index(solc_context* ctx);
+static void write_pooled(solc_context* ctx, SolList forms);
+static void count_constants(solc_context* ctx, SolObject obj);
+static bool write_constant(solc_context* ctx, unsigned char kind, const char* bytes, size_t length);
+
+static bool begin_sharing(solc_context* ctx, SolObject form);
+static size_t share_list(solc_context* ctx, SolList list);
+
+static void write_length(solc_context* ctx, uint64_t length);
+
+static void write_object(solc_context* ctx, SolObject obj);
+static void write_list(solc_context* ctx, SolList list);
+static void write_token(solc_context* ctx, SolToken token);
+static void write_string(solc_context* ctx, SolString string);
+static void write_number(solc_context* ctx, SolNumber number);
+static void write_compact_number(solc_context* ctx, double value);
+
+unsigned char* solc_emit(SolList source, off_t* size) {
+    solc_context* ctx = solc_context_create();
+    unsigned char* ret = solc_emit_ctx(ctx, source, size);
+    solc_exit_on_error(ctx);
+    solc_context_destroy(ctx);
+    return ret;
+}
+
+unsigned char* solc_emit_ctx(solc_context* ctx, SolList source, off_t* size) {
+    solc_begin(ctx);
+    solc_emit_begin(ctx, NULL, NULL);
+    emit_forms(ctx, source);
+    if (!solc_emit_end(ctx)) return NULL;
     
-    // store buffer length
-    if (size) *size = length;
-    
-    // remove temporary file
-    fclose(out);
-    
+    // hand the output buffer over to the caller
+    unsigned char* buffer = ctx->out.data;
+    if (size) *size = ctx->out.length;
+    ctx->out = (solc_buffer) { 0 };
     return buffer;
 }
 
-uint64_t htonll(uint64_t value) {
-    uint16_t num = 1;
-    if (*(char *)&num == 1) {
-        uint32_t high_part = htonl((uint32_t) (value >> 32));
-        uint32_t low_part = htonl((uint32_t) (value & 0xFFFFFFFFLL));
-        return (((uint64_t) low_part) << 32) | high_part;
+void solc_emit_to_callback(SolList source, solc_write_callback callback, void* data) {
+    solc_context* ctx = solc_context_create();
+    solc_emit_to_callback_ctx(ctx, source, callback, data);
+    solc_exit_on_error(ctx);
+    solc_context_destroy(ctx);
+}
+
+void solc_emit_to_fd(SolList source, int fd) {
+    solc_context* ctx = solc_context_create();
+    solc_emit_to_fd_ctx(ctx, source, fd);
+    solc_exit_on_error(ctx);
+    solc_context_destroy(ctx);
+}
+
+size_t solc_emit_to_buffer(SolList source, unsigned char* buffer, size_t capacity) {
+    solc_context* ctx = solc_context_create();
+    size_t size = 0;
+    solc_emit_to_buffer_ctx(ctx, source, buffer, capacity, &size);
+    solc_exit_on_error(ctx);
+    solc_context_destroy(ctx);
+    return size;
+}
+
+bool solc_emit_to_callback_ctx(solc_context* ctx, SolList source, solc_write_callback callback, void* data) {
+    solc_begin(ctx);
+    solc_emit_begin(ctx, callback, data);
+    emit_forms(ctx, source);
+    return solc_emit_end(ctx);
+}
+
+bool solc_emit_to_fd_ctx(solc_context* ctx, SolList source, int fd) {
+    return solc_emit_to_callback_ctx(ctx, source, write_fd, &fd);
+}
+
+bool solc_emit_to_buffer_ctx(solc_context* ctx, SolList source, unsigned char* buffer, size_t capacity, size_t* size) {
+    // borrow the caller's buffer in place of the context's own
+    solc_buffer owned = ctx->out;
+    ctx->out = (solc_buffer) { .data = buffer, .capacity = capacity, .fixed = true };
+    solc_begin(ctx);
+    solc_emit_begin(ctx, NULL, NULL);
+    emit_forms(ctx, source);
+    bool ret = solc_emit_end(ctx);
+    if (ret && size) *size = ctx->out.length;
+    ctx->out = owned;
+    return ret;
+}
+
+void solc_emit_begin(solc_context* ctx, solc_write_callback sink, void* data) {
+    ctx->out_sink = sink;
+    ctx->out_sink_data = data;
+    ctx->out.length = 0;
+    ctx->out_offset = 0;
+    ctx->index_count = 0;
+    // the constant pool precedes the forms that use it, so they are held
+    // back until all of them have been seen
+    if (ctx->format & SOLC_FORMAT_POOL) {
+        ctx->pending = (SolList) sol_obj_retain((SolObject) sol_list_create(false));
     } else {
-        return value;
+        write_header(ctx);
     }
 }
 
-uint64_t ntohll(uint64_t value) {
-    uint16_t num = 1;
-    if (*(char *)&num == 1) {
-        uint32_t high_part = ntohl((uint32_t) (value >> 32));
-        uint32_t low_part = ntohl((uint32_t) (value & 0xFFFFFFFFLL));
-        return (((uint64_t) low_part) << 32) | high_part;
+void solc_emit_form(solc_context* ctx, SolObject form) {
+    if (ctx->failed) return;
+    if (ctx->optimize) {
+        form = solc_optimize_form(ctx, form);
     } else {
-        return value;
+        sol_obj_retain(form);
+    }
+    if (ctx->pending) {
+        sol_list_add_obj(ctx->pending, form);
+    } else {
+        write_form(ctx, form);
+    }
+    sol_obj_release(form);
+}
+
+static void write_form(solc_context* ctx, SolObject form) {
+    if (!begin_sharing(ctx, form)) return;
+    uint64_t offset = ctx->out_offset + ctx->out.length;
+    write_object(ctx, form);
+    if (ctx->format & SOLC_FORMAT_INDEX) {
+        if (ctx->index_count == ctx->index_capacity) {
+            size_t capacity = ctx->index_capacity ? ctx->index_capacity * 2 : SOLC_INDEX_MIN_CAPACITY;
+            solc_index_entry* index = realloc(ctx->index, capacity * sizeof(*index));
+            if (index == NULL) {
+                emit_error(ctx, "out of memory");
+                return;
+            }
+            ctx->index = index;
+            ctx->index_capacity = capacity;
+        }
+        uint64_t length = ctx->out_offset + ctx->out.length - offset;
+        ctx->index[ctx->index_count++] = (solc_index_entry) { offset, length };
+    }
+    if (ctx->out_sink && ctx->out.length >= SOLC_EMIT_FLUSH_SIZE) {
+        flush_output(ctx);
+    }
+}
+
+bool solc_emit_end(solc_context* ctx) {
+    if (ctx->pending) {
+        SolList forms = ctx->pending;
+        ctx->pending = NULL;
+        if (!ctx->failed) write_pooled(ctx, forms);
+        sol_obj_release((SolObject) forms);
+        solc_pool_clear(&ctx->pool);
+    }
+    put_byte(ctx, 0x0);
+    if (ctx->format & SOLC_FORMAT_INDEX) {
+        write_index(ctx);
+    }
+    if (ctx->out_sink) {
+        flush_output(ctx);
+        ctx->out_sink = NULL;
+        ctx->out_sink_data = NULL;
+    }
+    if (ctx->failed && !ctx->out.fixed) {
+        free(ctx->out.data);
+        ctx->out = (solc_buffer) { 0 };
     }
+    return !ctx->failed;
 }
 
-void write_length(uint64_t length) {
-    if (length <= 0xF) {
-        char data = length + ((char) 0x1 << 0x4);
-        writec(data);
+bool solc_write_file(const unsigned char* bytes, size_t size, void* data) {
+    return fwrite(bytes, size, 1, (FILE*) data) == 1;
+}
+
+static void emit_forms(solc_context* ctx, SolList source) {
+    SOL_LIST_ITR(source, current, i) {
+        solc_emit_form(ctx, current->value);
+    }
+}
+
+static void write_header(solc_context* ctx) {
+    put_bytes(ctx, "SOLBIN", 6);
+    if (ctx->format) {
+        put_byte(ctx, 0xFE);
+        put_byte(ctx, 0x2);
+        put_byte(ctx, ctx->format);
+    }
+}
+
+static void write_index(solc_context* ctx) {
+    for (size_t i = 0; i < ctx->index_count; i++) {
+        put_u64(ctx, ctx->index[i].offset);
+        put_u64(ctx, ctx->index[i].length);
+    }
+    put_u64(ctx, ctx->index_count);
+    put_bytes(ctx, SOLC_INDEX_MAGIC, 8);
+}
+
+static void write_pooled(solc_context* ctx, SolList forms) {
+    SOL_LIST_ITR(forms, current, i) {
+        if (!begin_sharing(ctx, current->value)) return;
+        count_constants(ctx, current->value);
+    }
+    if (!ctx->failed && !solc_pool_build(&ctx->pool)) {
+        emit_error(ctx, "out of memory");
+    }
+    if (ctx->failed) return;
+    
+    // the pool is a count followed by each constant in its inline form
+    write_header(ctx);
+    put_varint(ctx, ctx->pool.count);
+    for (size_t i = 0; i < ctx->pool.count; i++) {
+        solc_constant* constant = ctx->pool.entries[i];
+        put_byte(ctx, constant->kind);
+        write_length(ctx, constant->length);
+        put_bytes(ctx, constant->bytes, constant->length);
+    }
+    SOL_LIST_ITR(forms, current, j) {
+        if (ctx->failed) return;
+        write_form(ctx, current->value);
+    }
+}
+
+static void count_constants(solc_context* ctx, SolObject obj) {
+    if (ctx->failed) return;
+    bool added = true;
+    if (obj->type_id == TYPE_SOL_LIST) {
+        // repeated lists are written once, so their constants count once
+        if (share_list(ctx, (SolList) obj) != SOLC_SHARE_NEW) return;
+        SOL_LIST_ITR((SolList) obj, current, i) {
+            count_constants(ctx, current->value);
+        }
+    } else if (obj->type_id == TYPE_SOL_TOKEN) {
+        SolToken token = (SolToken) obj;
+        if (!solc_is_atom(ctx, token, SOLC_ATOM_TRUE) && !solc_is_atom(ctx, token, SOLC_ATOM_FALSE)) {
+            added = solc_pool_add(&ctx->pool, 0x2, token->identifier, strlen(token->identifier));
+        }
+    } else if (obj->type_id == TYPE_SOL_DATATYPE && ((SolDatatype) obj)->type_id == DATA_TYPE_STR) {
+        SolString string = (SolString) obj;
+        added = solc_pool_add(&ctx->pool, 0x4, string->value, strlen(string->value));
+    }
+    if (!added) emit_error(ctx, "out of memory");
+}
+
+static bool write_constant(solc_context* ctx, unsigned char kind, const char* bytes, size_t length) {
+    solc_constant* constant = solc_pool_find(&ctx->pool, kind, bytes, length);
+    if (constant == NULL) return false;
+    put_byte(ctx, 0x7);
+    put_varint(ctx, constant->index);
+    return true;
+}
+
+static bool grow_output(solc_context* ctx, size_t size) {
+    if (ctx->failed) return false;
+    if (ctx->out.fixed) {
+        emit_error(ctx, "output does not fit in the %zu byte buffer", ctx->out.capacity);
+        return false;
+    }
+    size_t capacity = ctx->out.capacity ? ctx->out.capacity : SOLC_EMIT_BUFFER_SIZE;
+    while (capacity - ctx->out.length < size) {
+        capacity *= 2;
+    }
+    unsigned char* data = realloc(ctx->out.data, capacity);
+    if (data == NULL) {
+        emit_error(ctx, "out of memory");
+        return false;
+    }
+    ctx->out.data = data;
+    ctx->out.capacity = capacity;
+    return true;
+}
+
+static void flush_output(solc_context* ctx) {
+    if (!ctx->failed && ctx->out.length > 0 && !ctx->out_sink(ctx->out.data, ctx->out.length, ctx->out_sink_data)) {
+        emit_error(ctx, "error while writing compiled data");
+    }
+    ctx->out_offset += ctx->out.length;
+    ctx->out.length = 0;
+}
+
+static bool write_fd(const unsigned char* bytes, size_t size, void* data) {
+    int fd = *(int*) data;
+    while (size > 0) {
+        ssize_t count = write(fd, bytes, size);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        bytes += count;
+        size -= count;
+    }
+    return true;
+}
+
+static bool begin_sharing(solc_context* ctx, SolObject form) {
+    // lists are only shared within a top-level form, so that each form in
+    // the index can still be decoded on its own
+    if (!(ctx->format & SOLC_FORMAT_SHARE)) return true;
+    if (!solc_share_begin(&ctx->share, form)) {
+        emit_error(ctx, "out of memory");
+        return false;
+    }
+    return true;
+}
+
+static size_t share_list(solc_context* ctx, SolList list) {
+    size_t id = SOLC_SHARE_NEW;
+    if ((ctx->format & SOLC_FORMAT_SHARE) && !solc_share_visit(&ctx->share, list, &id)) {
+        emit_error(ctx, "out of memory");
+    }
+    return id;
+}
+
+static void write_length(solc_context* ctx, uint64_t length) {
+    if (ctx->format & SOLC_FORMAT_VARINT) {
+        put_varint(ctx, length);
+    } else if (length <= 0xF) {
+        put_byte(ctx, length + (0x1 << 0x4));
     } else if (length <= 0xFFF) {
-        uint16_t data = length + ((uint16_t) 0x2 << 0xC);
-        data = htons(data);
-        write(data, sizeof(data));
+        put_u16(ctx, length + ((uint16_t) 0x2 << 0xC));
     } else if (length <= 0xFFFFF) {
-        uint32_t data = length + ((uint32_t) 0x3 << 0x1C);
-        data = htonl(data);
-        write(data, sizeof(data));
+        put_u32(ctx, length + ((uint32_t) 0x3 << 0x1C));
     } else if (length <= 0xFFFFFFF) {
-        uint64_t data = length + ((uint64_t) 0x4 << 0x3C);
-        data = htonll(data);
-        write(data, sizeof(data));
+        put_u64(ctx, length + ((uint64_t) 0x4 << 0x3C));
+    } else {
+        emit_error(ctx, "length %llu is too large to encode", (unsigned long long) length);
     }
 }
 
-void write_object(SolObject obj) {
+static void write_object(solc_context* ctx, SolObject obj) {
     switch (obj->type_id) {
         case TYPE_SOL_LIST:
-            write_list((SolList) obj);
+            write_list(ctx, (SolList) obj);
             break;
         case TYPE_SOL_TOKEN:
-            write_token((SolToken) obj);
+            write_token(ctx, (SolToken) obj);
             break;
         case TYPE_SOL_DATATYPE:
             switch (((SolDatatype) obj)->type_id) {
                 case DATA_TYPE_NUM:
-                    write_number((SolNumber) obj);
+                    write_number(ctx, (SolNumber) obj);
                     break;
                 case DATA_TYPE_STR:
-                    write_string((SolString) obj);
+                    write_string(ctx, (SolString) obj);
                     break;
                 default:
-                    fprintf(stderr, "solc: error while emitting binary: unsupported data type\n");
-                    exit(EXIT_FAILURE);
+                    emit_error(ctx, "unsupported data type");
             }
             break;
         default:
-            fprintf(stderr, "solc: error while emitting binary: unsupported object type\n");
-            exit(EXIT_FAILURE);
+            emit_error(ctx, "unsupported object type");
     }
 }
 
-void write_list(SolList list) {
-    writec(0x1);
-    writec(list->object_mode);
-    write_length(list->length);
+static void write_list(solc_context* ctx, SolList list) {
+    size_t id = share_list(ctx, list);
+    if (id != SOLC_SHARE_NEW) {
+        put_byte(ctx, 0xB);
+        put_varint(ctx, id);
+        return;
+    }
+    put_byte(ctx, 0x1);
+    put_byte(ctx, list->object_mode);
+    write_length(ctx, list->length);
     SOL_LIST_ITR(list, current, i) {
-        write_object(current->value);
+        if (ctx->failed) return;
+        write_object(ctx, current->value);
     }
 }
 
-void write_token(SolToken token) {
+static void write_token(solc_context* ctx, SolToken token) {
     // handle special cases
     // handle data types
-    if (!strcmp(token->identifier, "true")) {
-        writec(0x5);
-        writec(1);
+    if (solc_is_atom(ctx, token, SOLC_ATOM_TRUE)) {
+        put_byte(ctx, 0x5);
+        put_byte(ctx, 1);
         return;
     }
-    if (!strcmp(token->identifier, "false")) {
-        writec(0x5);
-        writec(0);
+    if (solc_is_atom(ctx, token, SOLC_ATOM_FALSE)) {
+        put_byte(ctx, 0x5);
+        put_byte(ctx, 0);
         return;
     }
     // otherwise write a token
-    writec(0x2);
     uint64_t length = strlen(token->identifier);
-    write_length(length);
-    writes(token->identifier, sizeof(*token->identifier) * length);
+    if (ctx->pool.count && write_constant(ctx, 0x2, token->identifier, length)) return;
+    put_byte(ctx, 0x2);
+    write_length(ctx, length);
+    put_bytes(ctx, token->identifier, length);
 }
 
-void write_string(SolString string) {
-    writec(0x4);
+static void write_string(solc_context* ctx, SolString string) {
     uint64_t length = strlen(string->value);
-    write_length(length);
-    writes(string->value, sizeof(*string->value) * length);
+    if (ctx->pool.count && write_constant(ctx, 0x4, string->value, length)) return;
+    put_byte(ctx, 0x4);
+    write_length(ctx, length);
+    put_bytes(ctx, string->value, length);
 }
 
-void write_number(SolNumber number) {
-    writec(0x3);
+static void write_number(solc_context* ctx, SolNumber number) {
+    if (ctx->format & SOLC_FORMAT_NUMBERS) {
+        write_compact_number(ctx, number->value);
+        return;
+    }
+    put_byte(ctx, 0x3);
     // get the significand and exponent
     int32_t exponent;
     double fraction = frexp(number->value, &exponent);
-    int64_t significand = fraction * pow(2, 52);
+    int64_t significand = ldexp(fraction, 52);
     
-    significand = htonll(significand);
-    exponent = htonl(exponent);
-    write(significand, sizeof(significand));
-    write(exponent, sizeof(exponent));
+    put_u64(ctx, significand);
+    put_u32(ctx, exponent);
+}
+
+static void write_compact_number(solc_context* ctx, double value) {
+    // integers that a double holds exactly are written as integers, and
+    // anything else, including -0, bit for bit
+    if (value >= -SOLC_MAX_EXACT_INTEGER && value <= SOLC_MAX_EXACT_INTEGER
+            && value == (double) (int64_t) value && !(value == 0 && signbit(value))) {
+        int64_t integer = (int64_t) value;
+        if (integer >= INT8_MIN && integer <= INT8_MAX) {
+            put_byte(ctx, 0x8);
+            put_byte(ctx, (uint8_t) integer);
+        } else {
+            // zigzag keeps small negative numbers short
+            put_byte(ctx, 0x9);
+            put_varint(ctx, ((uint64_t) integer << 1) ^ (uint64_t) (integer >> 63));
+        }
+        return;
+    }
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    put_byte(ctx, 0xA);
+    put_u64(ctx, bits);
 }
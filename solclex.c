@@ -0,0 +1,206 @@
+#include "solclex.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+#if defined(__GNUC__) && defined(__SSE2__) && (defined(__x86_64__) || defined(__i386__))
+#define SOLC_LEX_X86 1
+#include <immintrin.h>
+#endif
+
+const unsigned char solc_char_class[256] = {
+    [' '] = SOLC_CHAR_SPACE, ['\t'] = SOLC_CHAR_SPACE, ['\n'] = SOLC_CHAR_SPACE,
+    ['\v'] = SOLC_CHAR_SPACE, ['\f'] = SOLC_CHAR_SPACE, ['\r'] = SOLC_CHAR_SPACE,
+    ['('] = SOLC_CHAR_BRACKET, [')'] = SOLC_CHAR_BRACKET,
+    ['['] = SOLC_CHAR_BRACKET, [']'] = SOLC_CHAR_BRACKET,
+    ['{'] = SOLC_CHAR_BRACKET, ['}'] = SOLC_CHAR_BRACKET,
+    ['0'] = SOLC_CHAR_DIGIT, ['1'] = SOLC_CHAR_DIGIT, ['2'] = SOLC_CHAR_DIGIT,
+    ['3'] = SOLC_CHAR_DIGIT, ['4'] = SOLC_CHAR_DIGIT, ['5'] = SOLC_CHAR_DIGIT,
+    ['6'] = SOLC_CHAR_DIGIT, ['7'] = SOLC_CHAR_DIGIT, ['8'] = SOLC_CHAR_DIGIT,
+    ['9'] = SOLC_CHAR_DIGIT,
+    ['.'] = SOLC_CHAR_GETTER, ['@'] = SOLC_CHAR_GETTER
+};
+
+typedef const char* (*solc_scan_kernel)(const char* p, const char* end);
+
+static pthread_once_t kernels_once = PTHREAD_ONCE_INIT;
+static solc_scan_kernel skip_space_kernel;
+static solc_scan_kernel find_delimiter_kernel;
+
+static void kernels_init(void);
+static const char* skip_space_scalar(const char* p, const char* end);
+static const char* find_delimiter_scalar(const char* p, const char* end);
+#ifdef SOLC_LEX_X86
+static const char* skip_space_sse2(const char* p, const char* end);
+static const char* find_delimiter_sse2(const char* p, const char* end);
+static const char* skip_space_avx2(const char* p, const char* end);
+static const char* find_delimiter_avx2(const char* p, const char* end);
+#endif
+
+const char* solc_skip_space(const char* p, const char* end) {
+    // most runs are a single separating space, so check inline first
+    if (p < end && !solc_char_is(*p, SOLC_CHAR_SPACE)) return p;
+    pthread_once(&kernels_once, kernels_init);
+    return skip_space_kernel(p, end);
+}
+
+const char* solc_find_delimiter(const char* p, const char* end) {
+    pthread_once(&kernels_once, kernels_init);
+    return find_delimiter_kernel(p, end);
+}
+
+const char* solc_find_newline(const char* p, const char* end) {
+    // memchr is already vectorized by the C library
+    const char* newline = memchr(p, '\n', end - p);
+    return newline ? newline : end;
+}
+
+size_t solc_scan_number(const char* p, const char* end, double* value) {
+    // powers of ten that are exactly representable as doubles
+    static const double powers[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    const char* start = p;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+    // hexadecimal literals are left to the slow path
+    if (end - p >= 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) return 0;
+    
+    // read up to 19 significant digits into the mantissa
+    uint64_t mantissa = 0;
+    int digits = 0, exponent = 0;
+    const char* digits_start = p;
+    for (; p < end && solc_char_is(*p, SOLC_CHAR_DIGIT); p++) {
+        if (mantissa == 0 && *p == '0') continue;
+        if (digits++ == 19) return 0;
+        mantissa = mantissa * 10 + (*p - '0');
+    }
+    bool any_digits = p > digits_start;
+    if (p < end && *p == '.') {
+        const char* fraction = ++p;
+        for (; p < end && solc_char_is(*p, SOLC_CHAR_DIGIT); p++) {
+            exponent--;
+            if (mantissa == 0 && *p == '0') continue;
+            if (digits++ == 19) return 0;
+            mantissa = mantissa * 10 + (*p - '0');
+        }
+        any_digits = any_digits || p > fraction;
+    }
+    if (!any_digits) return 0;
+    
+    // an exponent only counts when at least one digit follows it
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char* exp_p = p + 1;
+        bool exp_negative = false;
+        if (exp_p < end && (*exp_p == '-' || *exp_p == '+')) {
+            exp_negative = *exp_p == '-';
+            exp_p++;
+        }
+        if (exp_p < end && solc_char_is(*exp_p, SOLC_CHAR_DIGIT)) {
+            int exp_value = 0;
+            for (; exp_p < end && solc_char_is(*exp_p, SOLC_CHAR_DIGIT); exp_p++) {
+                if (exp_value < 10000) exp_value = exp_value * 10 + (*exp_p - '0');
+            }
+            exponent += exp_negative ? -exp_value : exp_value;
+            p = exp_p;
+        }
+    }
+    
+    // a mantissa below 2^53 times an exact power of ten rounds correctly
+    if (mantissa > ((uint64_t) 1 << 53) || exponent < -22 || exponent > 22) {
+        if (mantissa != 0) return 0;
+        exponent = 0;
+    }
+    double result = (double) mantissa;
+    result = exponent < 0 ? result / powers[-exponent] : result * powers[exponent];
+    *value = negative ? -result : result;
+    return p - start;
+}
+
+static void kernels_init(void) {
+    skip_space_kernel = skip_space_scalar;
+    find_delimiter_kernel = find_delimiter_scalar;
+#ifdef SOLC_LEX_X86
+    skip_space_kernel = skip_space_sse2;
+    find_delimiter_kernel = find_delimiter_sse2;
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        skip_space_kernel = skip_space_avx2;
+        find_delimiter_kernel = find_delimiter_avx2;
+    }
+#endif
+}
+
+static const char* skip_space_scalar(const char* p, const char* end) {
+    while (p < end && solc_char_is(*p, SOLC_CHAR_SPACE)) p++;
+    return p;
+}
+
+static const char* find_delimiter_scalar(const char* p, const char* end) {
+    while (p < end && !solc_char_is(*p, SOLC_CHAR_DELIMITER)) p++;
+    return p;
+}
+
+#ifdef SOLC_LEX_X86
+
+// whitespace is ' ' or '\t' through '\r', i.e. (c - '\t') <= 4 unsigned
+#define SPACE_MASK_SSE2(v) _mm_or_si128( \
+        _mm_cmpeq_epi8((v), _mm_set1_epi8(' ')), \
+        _mm_cmpeq_epi8(_mm_subs_epu8(_mm_sub_epi8((v), _mm_set1_epi8('\t')), _mm_set1_epi8(4)), _mm_setzero_si128()))
+#define BRACKET_MASK_SSE2(v) _mm_or_si128(_mm_or_si128( \
+        _mm_or_si128(_mm_cmpeq_epi8((v), _mm_set1_epi8('(')), _mm_cmpeq_epi8((v), _mm_set1_epi8(')'))), \
+        _mm_or_si128(_mm_cmpeq_epi8((v), _mm_set1_epi8('[')), _mm_cmpeq_epi8((v), _mm_set1_epi8(']')))), \
+        _mm_or_si128(_mm_cmpeq_epi8((v), _mm_set1_epi8('{')), _mm_cmpeq_epi8((v), _mm_set1_epi8('}'))))
+
+static const char* skip_space_sse2(const char* p, const char* end) {
+    for (; end - p >= 16; p += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*) p);
+        unsigned mask = ~_mm_movemask_epi8(SPACE_MASK_SSE2(v)) & 0xFFFF;
+        if (mask) return p + __builtin_ctz(mask);
+    }
+    return skip_space_scalar(p, end);
+}
+
+static const char* find_delimiter_sse2(const char* p, const char* end) {
+    for (; end - p >= 16; p += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*) p);
+        unsigned mask = _mm_movemask_epi8(_mm_or_si128(SPACE_MASK_SSE2(v), BRACKET_MASK_SSE2(v)));
+        if (mask) return p + __builtin_ctz(mask);
+    }
+    return find_delimiter_scalar(p, end);
+}
+
+#define SPACE_MASK_AVX2(v) _mm256_or_si256( \
+        _mm256_cmpeq_epi8((v), _mm256_set1_epi8(' ')), \
+        _mm256_cmpeq_epi8(_mm256_subs_epu8(_mm256_sub_epi8((v), _mm256_set1_epi8('\t')), _mm256_set1_epi8(4)), _mm256_setzero_si256()))
+#define BRACKET_MASK_AVX2(v) _mm256_or_si256(_mm256_or_si256( \
+        _mm256_or_si256(_mm256_cmpeq_epi8((v), _mm256_set1_epi8('(')), _mm256_cmpeq_epi8((v), _mm256_set1_epi8(')'))), \
+        _mm256_or_si256(_mm256_cmpeq_epi8((v), _mm256_set1_epi8('[')), _mm256_cmpeq_epi8((v), _mm256_set1_epi8(']')))), \
+        _mm256_or_si256(_mm256_cmpeq_epi8((v), _mm256_set1_epi8('{')), _mm256_cmpeq_epi8((v), _mm256_set1_epi8('}'))))
+
+__attribute__((target("avx2")))
+static const char* skip_space_avx2(const char* p, const char* end) {
+    for (; end - p >= 32; p += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*) p);
+        uint32_t mask = ~(uint32_t) _mm256_movemask_epi8(SPACE_MASK_AVX2(v));
+        if (mask) return p + __builtin_ctz(mask);
+    }
+    return skip_space_sse2(p, end);
+}
+
+__attribute__((target("avx2")))
+static const char* find_delimiter_avx2(const char* p, const char* end) {
+    for (; end - p >= 32; p += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*) p);
+        uint32_t mask = (uint32_t) _mm256_movemask_epi8(_mm256_or_si256(SPACE_MASK_AVX2(v), BRACKET_MASK_AVX2(v)));
+        if (mask) return p + __builtin_ctz(mask);
+    }
+    return find_delimiter_sse2(p, end);
+}
+
+#endif
@@ -0,0 +1,43 @@
+/* 
+ * File:   solclex.h
+ *
+ * Created on October 16, 2026
+ */
+
+#ifndef SOLCLEX_H
+#define	SOLCLEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define SOLC_CHAR_SPACE     0x1
+#define SOLC_CHAR_BRACKET   0x2
+#define SOLC_CHAR_DIGIT     0x4
+#define SOLC_CHAR_GETTER    0x8
+#define SOLC_CHAR_DELIMITER (SOLC_CHAR_SPACE | SOLC_CHAR_BRACKET)
+
+extern const unsigned char solc_char_class[256];
+
+static inline bool solc_char_is(char c, unsigned char char_class) {
+    return (solc_char_class[(unsigned char) c] & char_class) != 0;
+}
+
+/*
+ * Scanning kernels over [p, end). Each returns a pointer to the first byte
+ * that satisfies the search, or end if there is none. Vectorized versions
+ * are selected at runtime from what the CPU supports.
+ */
+const char* solc_skip_space(const char* p, const char* end);
+const char* solc_find_delimiter(const char* p, const char* end);
+const char* solc_find_newline(const char* p, const char* end);
+
+/*
+ * Scans a decimal number literal at p. Returns the number of bytes consumed
+ * and stores the value when it can be computed exactly from at most 19
+ * significant digits and a small exponent; returns 0 when the literal needs
+ * a correctly rounding conversion such as strtod() instead.
+ */
+size_t solc_scan_number(const char* p, const char* end, double* value);
+
+#endif	/* SOLCLEX_H */
+
@@ -0,0 +1,24 @@
+#include "solc.h"
+#include "solccontext.h"
+
+static void link_form(SolObject form, void* data);
+
+void solc_link_begin_ctx(solc_context* ctx, solc_write_callback callback, void* data) {
+    solc_begin(ctx);
+    solc_emit_begin(ctx, callback, data);
+}
+
+bool solc_link_unit_ctx(solc_context* ctx, const unsigned char* image, size_t size) {
+    // forms go to the emitter as soon as they are decoded, or are held with
+    // the rest of the program while the constant pool is gathered
+    if (ctx->failed) return false;
+    return solc_decode_forms(ctx, image, size, link_form, ctx);
+}
+
+bool solc_link_end_ctx(solc_context* ctx) {
+    return solc_emit_end(ctx);
+}
+
+static void link_form(SolObject form, void* data) {
+    solc_emit_form((solc_context*) data, form);
+}
@@ -0,0 +1,176 @@
+#include "solc.h"
+#include "solccontext.h"
+
+#include <string.h>
+#include <time.h>
+
+// a pass returns its rewrite of obj, retained, sharing whatever it left as-is
+typedef SolObject (*solc_pass_function)(solc_context* ctx, SolObject obj);
+
+typedef struct solc_pass {
+    const char* name;
+    solc_pass_function run;
+} solc_pass;
+
+static SolObject fold_freeze(solc_context* ctx, SolObject obj);
+static SolObject fold_arithmetic(solc_context* ctx, SolObject obj);
+
+// passes run over each top-level form in this order
+static const solc_pass passes[SOLC_PASS_COUNT] = {
+    { "fold-freeze", fold_freeze },
+    { "fold-arithmetic", fold_arithmetic }
+};
+
+static SolObject rewrite_items(solc_context* ctx, SolList list, solc_pass_function run);
+static bool is_call(solc_context* ctx, SolList list, solc_atom_id atom, int length);
+static void list_items(SolList list, SolObject* items, int count);
+static bool is_literal(solc_context* ctx, SolObject obj);
+static bool is_number(SolObject obj);
+
+void solc_context_set_optimize(solc_context* ctx, bool optimize) {
+    ctx->optimize = optimize;
+}
+
+bool solc_context_disable_pass(solc_context* ctx, const char* name) {
+    for (size_t i = 0; i < SOLC_PASS_COUNT; i++) {
+        if (!strcmp(passes[i].name, name)) {
+            ctx->disabled_passes |= 1u << i;
+            return true;
+        }
+    }
+    return false;
+}
+
+const solc_pass_stats* solc_context_pass_stats(solc_context* ctx, size_t* count) {
+    for (size_t i = 0; i < SOLC_PASS_COUNT; i++) {
+        ctx->pass_stats[i].name = passes[i].name;
+    }
+    *count = SOLC_PASS_COUNT;
+    return ctx->pass_stats;
+}
+
+SolList solc_optimize_ctx(solc_context* ctx, SolList program) {
+    solc_begin(ctx);
+    SolList ret = (SolList) sol_obj_retain((SolObject) sol_list_create(program->object_mode));
+    SOL_LIST_ITR(program, current, i) {
+        SolObject form = solc_optimize_form(ctx, current->value);
+        sol_list_add_obj(ret, form);
+        sol_obj_release(form);
+    }
+    return ret;
+}
+
+SolObject solc_optimize_form(solc_context* ctx, SolObject form) {
+    SolObject result = sol_obj_retain(form);
+    for (size_t i = 0; i < SOLC_PASS_COUNT; i++) {
+        if (ctx->disabled_passes & (1u << i)) continue;
+        struct timespec start, end;
+        ctx->pass = &ctx->pass_stats[i];
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        SolObject next = passes[i].run(ctx, result);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        ctx->pass->seconds += (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+        sol_obj_release(result);
+        result = next;
+    }
+    return result;
+}
+
+static SolObject fold_freeze(solc_context* ctx, SolObject obj) {
+    if (obj->type_id != TYPE_SOL_LIST) return sol_obj_retain(obj);
+    SolList list = (SolList) obj;
+    if (is_call(ctx, list, SOLC_ATOM_FREEZE, 2)) {
+        // literals evaluate to themselves, so freezing one changes nothing;
+        // anything else frozen is data and is left untouched
+        SolObject items[2];
+        list_items(list, items, 2);
+        SolObject value = items[1];
+        if (!is_literal(ctx, value)) return sol_obj_retain(obj);
+        ctx->pass->rewrites++;
+        return sol_obj_retain(value);
+    }
+    return rewrite_items(ctx, list, fold_freeze);
+}
+
+static SolObject fold_arithmetic(solc_context* ctx, SolObject obj) {
+    if (obj->type_id != TYPE_SOL_LIST) return sol_obj_retain(obj);
+    SolList list = (SolList) obj;
+    if (is_call(ctx, list, SOLC_ATOM_FREEZE, 2)) return sol_obj_retain(obj);
+    
+    // fold the operands first so nested expressions collapse bottom-up; the
+    // items of a data literal are evaluated too, but the literal itself,
+    // (op a b) parsed as (list op a b), is data and is never folded
+    SolList folded = (SolList) rewrite_items(ctx, list, fold_arithmetic);
+    if (folded->object_mode || folded->length != 3) return (SolObject) folded;
+    SolObject items[3];
+    list_items(folded, items, 3);
+    SolObject left = items[1], right = items[2];
+    if (items[0]->type_id != TYPE_SOL_TOKEN || !is_number(left) || !is_number(right)) {
+        return (SolObject) folded;
+    }
+    solc_atom_id ops[] = { SOLC_ATOM_ADD, SOLC_ATOM_SUBTRACT, SOLC_ATOM_MULTIPLY, SOLC_ATOM_DIVIDE };
+    for (size_t i = 0; i < sizeof(ops) / sizeof(*ops); i++) {
+        if (!solc_is_atom(ctx, (SolToken) items[0], ops[i])) continue;
+        double a = ((SolNumber) left)->value;
+        double b = ((SolNumber) right)->value;
+        double value;
+        switch (ops[i]) {
+            case SOLC_ATOM_ADD: value = a + b; break;
+            case SOLC_ATOM_SUBTRACT: value = a - b; break;
+            case SOLC_ATOM_MULTIPLY: value = a * b; break;
+            default:
+                // leave division by zero for the runtime to report
+                if (b == 0) return (SolObject) folded;
+                value = a / b;
+        }
+        sol_obj_release((SolObject) folded);
+        ctx->pass->rewrites++;
+        return sol_obj_retain((SolObject) sol_num_create(value));
+    }
+    return (SolObject) folded;
+}
+
+static SolObject rewrite_items(solc_context* ctx, SolList list, solc_pass_function run) {
+    // the list is only copied once one of its items has changed
+    SolList result = NULL;
+    SOL_LIST_ITR(list, current, i) {
+        SolObject item = run(ctx, current->value);
+        if (item != current->value && result == NULL) {
+            result = (SolList) sol_obj_retain((SolObject) sol_list_create(list->object_mode));
+            SOL_LIST_ITR(list, earlier, j) {
+                if (j == i) break;
+                sol_list_add_obj(result, earlier->value);
+            }
+        }
+        if (result) sol_list_add_obj(result, item);
+        sol_obj_release(item);
+    }
+    return result ? (SolObject) result : sol_obj_retain((SolObject) list);
+}
+
+static bool is_call(solc_context* ctx, SolList list, solc_atom_id atom, int length) {
+    if (list->object_mode || list->length != length) return false;
+    SolObject head;
+    list_items(list, &head, 1);
+    return head->type_id == TYPE_SOL_TOKEN && solc_is_atom(ctx, (SolToken) head, atom);
+}
+
+static void list_items(SolList list, SolObject* items, int count) {
+    SOL_LIST_ITR(list, current, i) {
+        if (i == count) break;
+        items[i] = current->value;
+    }
+}
+
+static bool is_literal(solc_context* ctx, SolObject obj) {
+    if (obj->type_id == TYPE_SOL_TOKEN) {
+        SolToken token = (SolToken) obj;
+        return solc_is_atom(ctx, token, SOLC_ATOM_TRUE) || solc_is_atom(ctx, token, SOLC_ATOM_FALSE);
+    }
+    return obj->type_id == TYPE_SOL_DATATYPE && (((SolDatatype) obj)->type_id == DATA_TYPE_NUM
+            || ((SolDatatype) obj)->type_id == DATA_TYPE_STR);
+}
+
+static bool is_number(SolObject obj) {
+    return obj->type_id == TYPE_SOL_DATATYPE && ((SolDatatype) obj)->type_id == DATA_TYPE_NUM;
+}
@@ -1,403 +1,506 @@
-
 #include "solc.h"
+#include "solccontext.h"
+#include "solclex.h"
 
 #include <string.h>
 #include <ctype.h>
 #include <sys/types.h>
 #include <sys/stat.h>
-#include <pcre.h>
+#include <sys/mman.h>
 
-static char* src;
+#define parse_error(ctx, position, ...) solc_error((ctx), "parsing source", (position), __VA_ARGS__)
 
-SolObject read_object();
-SolObject read_list(bool object_mode, bool frozen);
-SolObject read_object_literal(char* parent);
-SolObject read_function_literal(SolList param_list, bool macro);
-SolObject read_token();
-SolString read_string();
-SolNumber read_number();
+static bool read_lexeme(solc_context* ctx);
+static bool lexeme_incomplete(solc_context* ctx);
+static void open_frame(solc_context* ctx, solc_frame_kind kind, bool macro, SolList list, SolToken parent);
+static void close_frame(solc_context* ctx);
+static void finish_object(solc_context* ctx, SolObject object);
+static void check_complete(solc_context* ctx);
+static SolList object_literal_list(solc_context* ctx);
+static void release_modifiers(solc_modifiers* modifiers);
+static SolObject read_token(solc_context* ctx);
+static SolString read_string(solc_context* ctx);
+static SolNumber read_number(solc_context* ctx);
 
-bool is_delimiter(char c);
+static void collect_form(SolObject form, void* data);
+static char peek(solc_context* ctx, size_t offset);
+static SolObject split_getter_chain(solc_context* ctx, const char* token, size_t len);
 
 SolList solc_parse_f(FILE* source) {
+    solc_context* ctx = solc_context_create();
+    SolList ret = solc_parse_f_ctx(ctx, source);
+    solc_exit_on_error(ctx);
+    solc_context_destroy(ctx);
+    return ret;
+}
+
+SolList solc_parse(char* source) {
+    solc_context* ctx = solc_context_create();
+    SolList ret = solc_parse_ctx(ctx, source);
+    solc_exit_on_error(ctx);
+    solc_context_destroy(ctx);
+    return ret;
+}
+
+SolList solc_parse_n(const char* source, size_t length) {
+    solc_context* ctx = solc_context_create();
+    SolList ret = solc_parse_n_ctx(ctx, source, length);
+    solc_exit_on_error(ctx);
+    solc_context_destroy(ctx);
+    return ret;
+}
+
+SolList solc_parse_f_ctx(solc_context* ctx, FILE* source) {
+    solc_begin(ctx);
+    
     // get file size
     struct stat st;
     if (fstat(fileno(source), &st)) {
-        fprintf(stderr, "solc: error while parsing source: could not determine file size - cannot stat\n");
-        exit(EXIT_FAILURE);
+        parse_error(ctx, NULL, "could not determine file size - cannot stat");
+        return NULL;
     }
-    off_t size = st.st_size;
+    off_t offset = ftello(source);
+    if (offset < 0) offset = 0;
     
-    // read file contents
-    char* contents = malloc(size + 1);
-    if (fread(contents, size, 1, source) != 1) {
-        fprintf(stderr, "solc: error while parsing source: error while reading file\n");
-        exit(EXIT_FAILURE);
+    // map regular files directly and parse them in place
+    if (S_ISREG(st.st_mode) && st.st_size > offset) {
+        void* contents = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(source), 0);
+        if (contents != MAP_FAILED) {
+            posix_madvise(contents, st.st_size, POSIX_MADV_SEQUENTIAL);
+            SolList ret = solc_parse_n_ctx(ctx, (const char*) contents + offset, st.st_size - offset);
+            munmap(contents, st.st_size);
+            return ret;
+        }
+    }
+    
+    // otherwise read file contents
+    size_t size = 0, capacity = S_ISREG(st.st_mode) && st.st_size > 0 ? st.st_size : BUFSIZ;
+    char* contents = malloc(capacity);
+    size_t count;
+    while (contents && (count = fread(contents + size, 1, capacity - size, source)) > 0) {
+        size += count;
+        if (size == capacity) {
+            char* grown = realloc(contents, capacity *= 2);
+            if (grown == NULL) free(contents);
+            contents = grown;
+        }
+    }
+    if (contents == NULL || ferror(source)) {
+        free(contents);
+        parse_error(ctx, NULL, "error while reading file");
+        return NULL;
     }
-    contents[size] = '\0';
     
     // parse file
-    SolList ret = solc_parse(contents);
+    SolList ret = solc_parse_n_ctx(ctx, contents, size);
     free(contents);
     return ret;
 }
 
-SolList solc_parse(char* source) {
-    // set up static variables
-    src = source;
+SolList solc_parse_ctx(solc_context* ctx, char* source) {
+    return solc_parse_n_ctx(ctx, source, strlen(source));
+}
+
+SolList solc_parse_n_ctx(solc_context* ctx, const char* source, size_t length) {
+    solc_begin(ctx);
     SolList out = (SolList) sol_obj_retain((SolObject) sol_list_create(false));
-    
-    // trim whitespace
-    while (isspace(*src)) {
-        src++;
+    if (!solc_parse_forms(ctx, source, length, collect_form, out)) {
+        sol_obj_release((SolObject) out);
+        return NULL;
     }
-    char* end = src + strlen(src);
-    while (isspace(*end)) {
-        end--;
-    }
-    *end = '\0';
+    return out;
+}
+
+bool solc_parse_forms(solc_context* ctx, const char* source, size_t length, solc_form_callback callback, void* data) {
+    solc_parse_start(ctx, callback, data);
+    return solc_parse_resume(ctx, source, 0, length, false);
+}
+
+void solc_parse_start(solc_context* ctx, solc_form_callback callback, void* data) {
+    solc_parse_unwind(ctx);
+    ctx->callback = callback;
+    ctx->callback_data = data;
+}
+
+bool solc_parse_resume(solc_context* ctx, const char* buffer, size_t from, size_t length, bool partial) {
+    // set up parser state
+    ctx->begin = buffer;
+    ctx->src = buffer + from;
+    ctx->end = buffer + length;
+    ctx->partial = partial;
     
-    // begin parsing
-    while (*src != '\0') {
-        SolObject object = read_object();
-        if (object != NULL) {
-            sol_list_add_obj(out, object);
+    // if more input may follow, a token running up to the end of the buffer
+    // could be cut off, so only lexemes before the last delimiter are settled
+    ctx->settled = ctx->end;
+    if (partial) {
+        while (ctx->settled > ctx->src && !solc_char_is(ctx->settled[-1], SOLC_CHAR_DELIMITER)) {
+            ctx->settled--;
         }
     }
     
-    return out;
+    // parse until the buffer runs out or a lexeme needs more input
+    while (ctx->src < ctx->end && !ctx->failed) {
+        if (!read_lexeme(ctx)) break;
+    }
+    if (!partial && !ctx->failed) {
+        check_complete(ctx);
+    }
+    if (ctx->failed) {
+        solc_parse_unwind(ctx);
+        return false;
+    }
+    return true;
+}
+
+void solc_parse_unwind(solc_context* ctx) {
+    // release whatever a failed or abandoned parse left open
+    while (ctx->frame_count > 0) {
+        solc_frame* frame = &ctx->frames[--ctx->frame_count];
+        if (frame->list) sol_obj_release((SolObject) frame->list);
+        if (frame->parent) sol_obj_release((SolObject) frame->parent);
+    }
+    release_modifiers(&ctx->modifiers);
 }
 
-SolObject read_object() {
-    // handle special flags
-    bool func_modifier = false, macro_modifier = false, obj_modifier = false;
-    SolToken obj_literal_parent = NULL;
-    SolList func_literal_params = NULL;
-    while (*src != '\0') {
-        bool func_modifier_active = func_modifier;
-        bool macro_modifier_active = macro_modifier;
-        bool obj_modifier_active = obj_modifier;
-        SolToken obj_literal_parent_active = obj_literal_parent;
-        SolList func_literal_params_active = func_literal_params;
-        func_modifier = macro_modifier = obj_modifier = false;
-        obj_literal_parent = NULL;
-        func_literal_params = NULL;
-        
-        // validate modifiers
-        if (func_modifier_active && macro_modifier_active) {
-            fprintf(stderr, "solc: error while parsing source: function and macro modifiers cannot be applied to the same object\n");
+static bool read_lexeme(solc_context* ctx) {
+    const char* start = ctx->src;
+    
+    // wait for more input if the lexeme may continue past the buffer
+    if (ctx->partial && lexeme_incomplete(ctx)) {
+        return false;
+    }
+    
+    // a parameter list has to be followed directly by the function body
+    if (ctx->modifiers.expect_body && *start != '{') {
+        parse_error(ctx, start, "function modifier found before frozen list");
+        return true;
+    }
+    
+    // modifiers only apply to the object directly after them
+    solc_modifiers active = ctx->modifiers;
+    ctx->modifiers = (solc_modifiers) { 0 };
+    if (active.function && active.macro) {
+        parse_error(ctx, start, "function and macro modifiers cannot be applied to the same object");
+        release_modifiers(&active);
+        return true;
+    }
+    
+    // skip whitespace chars
+    if (solc_char_is(*start, SOLC_CHAR_SPACE)) {
+        ctx->src = solc_skip_space(ctx->src, ctx->end);
+        release_modifiers(&active);
+        return true;
+    }
+    
+    // process number literals
+    if (solc_char_is(*start, SOLC_CHAR_DIGIT) || (*start == '-' && solc_char_is(peek(ctx, 1), SOLC_CHAR_DIGIT))) {
+        finish_object(ctx, (SolObject) read_number(ctx));
+        release_modifiers(&active);
+        return true;
+    }
+    
+    // process other datatypes
+    switch (*start) {
+        case ';': // COMMENTS
+            ctx->src = solc_find_newline(ctx->src, ctx->end);
+            break;
+        case '"': { // STRINGS
+            SolString string = read_string(ctx);
+            if (string == NULL && !ctx->failed) {
+                // the closing quote has not been read yet
+                ctx->modifiers = active;
+                return false;
+            }
+            finish_object(ctx, (SolObject) string);
+            break;
         }
-        
-        // skip whitespace chars
-        if (isspace(*src)) {
-            src++;
-            continue;
+        case '(': { // LISTS
+            if (active.function || active.macro) {
+                SolList params = (SolList) sol_obj_retain((SolObject) sol_list_create(false));
+                sol_list_add_obj(params, (SolObject) solc_atom(ctx, SOLC_ATOM_LIST));
+                open_frame(ctx, SOLC_FRAME_PARAMETERS, active.macro, params, NULL);
+                break;
+            }
+            SolList list = (SolList) sol_obj_retain((SolObject) sol_list_create(false));
+            sol_list_add_obj(list, (SolObject) solc_atom(ctx, active.object ? SOLC_ATOM_OBJECT_LIST : SOLC_ATOM_LIST));
+            open_frame(ctx, SOLC_FRAME_LIST, false, list, NULL);
+            break;
         }
-        
-        // process number literals
-        if (isdigit(*src) || (*src == '-' && isdigit(*(src + 1)))) {
-            return (SolObject) read_number();
+        case '[': { // STATEMENTS
+            SolList statements = (SolList) sol_obj_retain((SolObject) sol_list_create(active.object));
+            if (active.function || active.macro) {
+                open_frame(ctx, SOLC_FRAME_FUNCTION_STATEMENTS, active.macro, statements, NULL);
+            } else {
+                open_frame(ctx, SOLC_FRAME_STATEMENTS, false, statements, NULL);
+            }
+            break;
         }
-        
-        // process other datatypes
-        switch (*src) {
-            case ';': // COMMENTS
-                src = strchr(src, '\n') + 1;
-                continue;
-            case '"': // STRINGS
-                return (SolObject) read_string();
-            case '(': // LISTS
-                if (func_modifier_active || macro_modifier_active) {
-                    SolList list = (SolList) read_list(false, true);
-                    if (*(src) == '{') {
-                        if (func_modifier_active) {
-                            func_modifier = true;
-                        } else {
-                            macro_modifier = true;
-                        }
-                        func_literal_params = list;
-                        continue;
-                    }
-                    fprintf(stderr, "solc: error while parsing source: function modifier found before frozen list\n");
-                    exit(EXIT_FAILURE);
-                }
-                return (SolObject) read_list(obj_modifier_active, true);
-            case '[': // STATEMENTS
-                if (func_modifier_active || macro_modifier_active) {
-                    SolList func_list = (SolList) sol_obj_retain((SolObject) sol_list_create(false));
-                    sol_list_add_obj(func_list, (SolObject) sol_token_create(macro_modifier_active ? "#" : "^"));
-                    SolList param_list = sol_list_create(false);
-                    sol_list_add_obj(func_list, (SolObject) param_list);
-                    sol_list_add_obj(param_list, (SolObject) sol_token_create("freeze"));
-                    sol_list_add_obj(param_list, (SolObject) sol_list_create(false));
-                    sol_list_add_obj(func_list, (SolObject) read_list(obj_modifier_active, false));
-                    return (SolObject) func_list;
-                }
-                return (SolObject) read_list(obj_modifier_active, false);
-            case '{': // OBJECT LITERALS
-                if (obj_modifier_active) {
-                    if (obj_literal_parent_active) {
-                        SolObject literal = (SolObject) read_object_literal(obj_literal_parent_active->identifier);
-                        sol_obj_release((SolObject) obj_literal_parent_active);
-                        return literal;
-                    }
-                    return (SolObject) read_object_literal("Object");
-                }
-                if (func_modifier_active || macro_modifier_active) {
-                    return (SolObject) read_function_literal(func_literal_params_active ? func_literal_params_active : (SolList) nil, macro_modifier_active);
-                }
-                return (SolObject) read_object_literal(NULL);
-            case '^': // FUNCTION SHORTHAND
-                if (src[1] == '[' || src[1] == '(' || src[1] == '{'
-                        || (src[1] == '@' && src[2] == '[')) {
-                    func_modifier = true;
-                    src++;
-                    continue;
-                }
-                return read_token();
-            case '#': // MACRO SHORTHAND
-                if (src[1] == '[' || src[1] == '(' || src[1] == '{'
-                    || (src[1] == '@' && src[2] == '[')) {
-                    macro_modifier = true;
-                    src++;
-                    continue;
-                }
-                return read_token();
-            case '@': // OBJECT MODE STATEMENTS
-                if (src[1] == '[' || src[1] == '(' || src[1] == '{') {
-                    obj_modifier = true;
-                    func_modifier = func_modifier_active;
-                    src++;
-                    continue;
-                }
-                char* lookahead = src + 1;
-                for (; !is_delimiter(*lookahead); lookahead++) {}
-                if (*lookahead == '{') {
-                    obj_modifier = true;
-                    src++;
-                    obj_literal_parent = (SolToken) read_token();
-                    if (obj_literal_parent->super.type_id != TYPE_SOL_TOKEN) {
-                        fprintf(stderr, "solc: error while parsing source: object literal parent was not a token\n");
-                        exit(EXIT_FAILURE);
-                    }
-                    continue;
+        case '{': // OBJECT LITERALS
+            if (active.object) {
+                SolToken parent = active.parent ? active.parent : (SolToken) sol_obj_retain((SolObject) solc_atom(ctx, SOLC_ATOM_OBJECT));
+                active.parent = NULL;
+                open_frame(ctx, SOLC_FRAME_OBJECT_LITERAL, false, object_literal_list(ctx), parent);
+            } else if (active.function || active.macro) {
+                SolList literal = (SolList) sol_obj_retain((SolObject) sol_list_create(false));
+                sol_list_add_obj(literal, (SolObject) solc_atom(ctx, active.macro ? SOLC_ATOM_MACRO : SOLC_ATOM_FUNCTION));
+                sol_list_add_obj(literal, active.params ? (SolObject) active.params : nil);
+                open_frame(ctx, SOLC_FRAME_FUNCTION_LITERAL, active.macro, literal, NULL);
+            } else {
+                open_frame(ctx, SOLC_FRAME_OBJECT_LITERAL, false, object_literal_list(ctx), NULL);
+            }
+            break;
+        case ')': case ']': case '}':
+            close_frame(ctx);
+            break;
+        case '^': // FUNCTION SHORTHAND
+            if (peek(ctx, 1) == '[' || peek(ctx, 1) == '(' || peek(ctx, 1) == '{'
+                    || (peek(ctx, 1) == '@' && peek(ctx, 2) == '[')) {
+                ctx->modifiers.function = true;
+                ctx->src++;
+                break;
+            }
+            finish_object(ctx, read_token(ctx));
+            break;
+        case '#': // MACRO SHORTHAND
+            if (peek(ctx, 1) == '[' || peek(ctx, 1) == '(' || peek(ctx, 1) == '{'
+                || (peek(ctx, 1) == '@' && peek(ctx, 2) == '[')) {
+                ctx->modifiers.macro = true;
+                ctx->src++;
+                break;
+            }
+            finish_object(ctx, read_token(ctx));
+            break;
+        case '@': { // OBJECT MODE STATEMENTS
+            if (peek(ctx, 1) == '[' || peek(ctx, 1) == '(' || peek(ctx, 1) == '{') {
+                ctx->modifiers.object = true;
+                ctx->modifiers.function = active.function;
+                ctx->src++;
+                break;
+            }
+            const char* lookahead = solc_find_delimiter(ctx->src + 1, ctx->end);
+            if (lookahead < ctx->end && *lookahead == '{') {
+                ctx->src++;
+                const char* parent_start = ctx->src;
+                SolToken parent = (SolToken) read_token(ctx);
+                if (parent == NULL) break;
+                if (parent->super.type_id != TYPE_SOL_TOKEN) {
+                    sol_obj_release((SolObject) parent);
+                    parse_error(ctx, parent_start, "object literal parent was not a token");
+                    break;
                 }
-                return read_token();
-            case ':': // FROZEN OBJECTS
-                src++;
-                SolObject obj = read_object();
-                SolList list = (SolList) sol_obj_retain((SolObject) sol_list_create(false));
-                sol_list_add_obj(list, (SolObject) sol_token_create("freeze"));
-                sol_list_add_obj(list, obj);
-                sol_obj_release(obj);
-                return (SolObject) list;
-            default:
-                return read_token();
+                ctx->modifiers.object = true;
+                ctx->modifiers.parent = parent;
+                break;
+            }
+            finish_object(ctx, read_token(ctx));
+            break;
         }
+        case ':': // FROZEN OBJECTS
+            open_frame(ctx, SOLC_FRAME_FREEZE, false, NULL, NULL);
+            break;
+        default:
+            finish_object(ctx, read_token(ctx));
     }
-    return NULL;
+    release_modifiers(&active);
+    return true;
 }
 
-SolObject read_list(bool object_mode, bool frozen) {
-    // advance past open delimiter
-    src++;
-    SolList list = (SolList) sol_obj_retain((SolObject) sol_list_create((!frozen && object_mode) ? true : false));
-    while (*src != '\0') {
-        // skip whitespace characters
-        if (isspace(*src)) {
-            src++;
-            continue;
-        }
-        // handle list termination
-        if (*src == (frozen ? ')' : ']')) {
-            src++;
-            if (frozen) {
-                sol_list_insert_object(list, (SolObject) sol_token_create(object_mode ? "@list" : "list"), 0);
-            }
-            return (SolObject) list;
-        }
-        // add object
-        SolObject object = read_object();
-        sol_list_add_obj(list, object);
-        sol_obj_release(object);
+static bool lexeme_incomplete(solc_context* ctx) {
+    const char* start = ctx->src;
+    switch (*start) {
+        case ';':
+            return solc_find_newline(start, ctx->end) == ctx->end;
+        case '"':
+            // read_string finds the closing quote itself
+            return false;
+        case '^': case '#': case '@':
+            // modifiers look up to two characters ahead
+            if (ctx->end - start < 3) return true;
+            // fall through
+        default:
+            return start >= ctx->settled;
     }
-    fprintf(stderr, "solc: error while parsing source: encountered unclosed list\n");
-    exit(EXIT_FAILURE);
 }
 
-SolObject read_object_literal(char* parent) {
-    // advance past open delimiter
-    src++;
-    // create raw parameter
-    SolList raw_list = (SolList) sol_obj_retain((SolObject) sol_list_create(true));
-    sol_list_add_obj(raw_list, (SolObject) sol_token_create("Object"));
-    sol_list_add_obj(raw_list, (SolObject) sol_token_create("create"));
-    // read literal data
-    while (*src != '\0') {
-        // skip whitespace characters
-        if (isspace(*src)) {
-            src++;
-            continue;
-        }
-        // handle literal termination
-        if (*src == '}') {
-            src++;
-            if (parent) {
-                SolList result_list = (SolList) sol_obj_retain((SolObject) sol_list_create(true));
-                sol_list_add_obj(result_list, (SolObject) sol_token_create(parent));
-                sol_list_add_obj(result_list, (SolObject) sol_token_create("clone"));
-                sol_list_add_obj(result_list, (SolObject) raw_list);
-                sol_obj_release((SolObject) raw_list);
-                return (SolObject) result_list;
-            } else {
-                return (SolObject) raw_list;
-            }
+static void open_frame(solc_context* ctx, solc_frame_kind kind, bool macro, SolList list, SolToken parent) {
+    if (ctx->frame_count == ctx->frame_capacity) {
+        size_t capacity = ctx->frame_capacity ? ctx->frame_capacity * 2 : SOLC_FRAME_STACK_SIZE;
+        solc_frame* frames = realloc(ctx->frames, capacity * sizeof(*frames));
+        if (frames == NULL) {
+            if (list) sol_obj_release((SolObject) list);
+            if (parent) sol_obj_release((SolObject) parent);
+            parse_error(ctx, ctx->src, "out of memory - nesting too deep");
+            return;
         }
-        // read key/value
-        SolObject key = read_object();
-        SolObject value = read_object();
-        sol_list_add_obj(raw_list, key);
-        sol_list_add_obj(raw_list, value);
-        sol_obj_release(key);
-        sol_obj_release(value);
+        ctx->frames = frames;
+        ctx->frame_capacity = capacity;
     }
-    fprintf(stderr, "solc: error while parsing source: encountered unclosed object literal\n");
-    exit(EXIT_FAILURE);
+    ctx->frames[ctx->frame_count++] = (solc_frame) {
+        .kind = kind, .macro = macro, .open = ctx->src - ctx->begin, .list = list, .parent = parent
+    };
+    ctx->src++;
 }
 
-SolObject read_function_literal(SolList param_list, bool macro) {
-    // advance past open delimiter
-    src++;
-    SolList statement_list = (SolList) sol_obj_retain((SolObject) sol_list_create(false));
-    // read literal data
-    while (*src != '\0') {
-        // skip whitespace characters
-        if (isspace(*src)) {
-            src++;
-            continue;
+static void close_frame(solc_context* ctx) {
+    // the delimiter has to close the innermost open frame
+    char delimiter = *ctx->src;
+    char expected = '\0';
+    solc_frame* frame = ctx->frame_count > 0 ? &ctx->frames[ctx->frame_count - 1] : NULL;
+    if (frame) switch (frame->kind) {
+        case SOLC_FRAME_LIST:
+        case SOLC_FRAME_PARAMETERS:
+            expected = ')';
+            break;
+        case SOLC_FRAME_STATEMENTS:
+        case SOLC_FRAME_FUNCTION_STATEMENTS:
+            expected = ']';
+            break;
+        case SOLC_FRAME_OBJECT_LITERAL:
+            // a key without a value cannot be closed
+            expected = frame->list->length % 2 == 0 ? '}' : '\0';
+            break;
+        case SOLC_FRAME_FUNCTION_LITERAL:
+            expected = '}';
+            break;
+        case SOLC_FRAME_FREEZE:
+            break;
+    }
+    if (delimiter != expected) {
+        parse_error(ctx, ctx->src, "unexpected '%c'", delimiter);
+        return;
+    }
+    solc_frame closed = *frame;
+    ctx->frame_count--;
+    ctx->src++;
+    
+    SolList result = closed.list;
+    switch (closed.kind) {
+        case SOLC_FRAME_PARAMETERS:
+            // the parameters wait for the function body
+            ctx->modifiers.function = !closed.macro;
+            ctx->modifiers.macro = closed.macro;
+            ctx->modifiers.expect_body = true;
+            ctx->modifiers.params = closed.list;
+            return;
+        case SOLC_FRAME_FUNCTION_STATEMENTS: {
+            result = (SolList) sol_obj_retain((SolObject) sol_list_create(false));
+            sol_list_add_obj(result, (SolObject) solc_atom(ctx, closed.macro ? SOLC_ATOM_MACRO : SOLC_ATOM_FUNCTION));
+            SolList param_list = sol_list_create(false);
+            sol_list_add_obj(result, (SolObject) param_list);
+            sol_list_add_obj(param_list, (SolObject) solc_atom(ctx, SOLC_ATOM_FREEZE));
+            sol_list_add_obj(param_list, (SolObject) sol_list_create(false));
+            sol_list_add_obj(result, (SolObject) closed.list);
+            sol_obj_release((SolObject) closed.list);
+            break;
         }
-        // handle literal termination
-        if (*src == '}') {
-            src++;
-            SolList result_list = (SolList) sol_obj_retain((SolObject) sol_list_create(false));
-            sol_list_add_obj(result_list, (SolObject) sol_token_create(macro ? "#" : "^"));
-            sol_list_add_obj(result_list, (SolObject) param_list);
-            sol_obj_release((SolObject) param_list);
-            SOL_LIST_ITR(statement_list, current, i) {
-                sol_list_add_obj(result_list, current->value);
+        case SOLC_FRAME_OBJECT_LITERAL:
+            if (closed.parent) {
+                result = (SolList) sol_obj_retain((SolObject) sol_list_create(true));
+                sol_list_add_obj(result, (SolObject) closed.parent);
+                sol_list_add_obj(result, (SolObject) solc_atom(ctx, SOLC_ATOM_CLONE));
+                sol_list_add_obj(result, (SolObject) closed.list);
+                sol_obj_release((SolObject) closed.parent);
+                sol_obj_release((SolObject) closed.list);
             }
-            return (SolObject) result_list;
-        }
-        // read key/value
-        SolObject statement = read_object();
-        sol_list_add_obj(statement_list, statement);
-        sol_obj_release(statement);
+            break;
+        default:
+            break;
     }
-    fprintf(stderr, "solc: error while parsing source: encountered unclosed function literal\n");
-    exit(EXIT_FAILURE);
+    finish_object(ctx, (SolObject) result);
 }
 
-SolObject read_token() {
-    // read token to buffer
-    char* buff = malloc(256);
-    size_t buff_size = 256;
-    char* buff_pos = buff;
-    for (; !is_delimiter(*src); src++) {
-        if (buff_pos - buff == buff_size) {
-            buff = realloc(buff, buff_size *= 2);
-            buff_pos = buff + buff_size/2;
-        }
-        *buff_pos = *src;
-        buff_pos++;
+static void finish_object(solc_context* ctx, SolObject object) {
+    if (object == NULL) return;
+    // wrap the object for every ':' waiting on it
+    while (ctx->frame_count > 0 && ctx->frames[ctx->frame_count - 1].kind == SOLC_FRAME_FREEZE) {
+        SolList list = (SolList) sol_obj_retain((SolObject) sol_list_create(false));
+        sol_list_add_obj(list, (SolObject) solc_atom(ctx, SOLC_ATOM_FREEZE));
+        sol_list_add_obj(list, object);
+        sol_obj_release(object);
+        object = (SolObject) list;
+        ctx->frame_count--;
     }
-    size_t result_len = buff_pos - buff;
-    char* result = memcpy(malloc(result_len + 1), buff, result_len);
-    result[result_len] = '\0';
-    free(buff);
-    
-    // handle object '.'/'@' getter shorthand
-    static pcre* regex = NULL;
-    if (regex == NULL) {
-        const char* error_msg;
-        int error_pos;
-        regex = pcre_compile("[.@]?[^.@]+[.@]*", 0, &error_msg, &error_pos, NULL);
-        if (regex == NULL) {
-            printf("regex compilation failed at offset %d: %s\n", error_pos, error_msg);
-        }
+    // hand complete forms to the caller, otherwise add to the enclosing list
+    if (ctx->frame_count == 0) {
+        ctx->callback(object, ctx->callback_data);
+    } else {
+        sol_list_add_obj(ctx->frames[ctx->frame_count - 1].list, object);
     }
-    int osize = 15;
-    int* ovector = malloc(sizeof(*ovector) * osize);
-    int matches;
-    int offset = 0;
-    int len = strlen(result);
-    SolObject result_object = NULL;
-    while (matches = pcre_exec(regex, NULL, result, len, offset, 0, ovector, osize), ovector[1] > ovector[0]) {
-        if (matches == 0) {
-            osize *= 2;
-            realloc(ovector, osize);
-            continue;
-        }
-        char* match;
-        int match_len = pcre_get_substring(result, ovector, matches, 0, (const char**) &match);
-        offset = ovector[1];
-        char final = match[match_len - 1];
-        if (final == '.' || final == '@') {
-            SolList list = sol_list_create(true);
-            match[match_len - 1] = '\0';
-            if (!result_object) {
-                sol_list_add_obj(list, (SolObject) sol_token_create(match));
-            } else {
-                SolList current_list = (SolList) result_object;
-                SolList frozen = (SolList) sol_obj_retain((SolObject) sol_list_create(false));
-                sol_list_add_obj(frozen, (SolObject) sol_token_create("freeze"));
-                sol_list_add_obj(frozen, (SolObject) sol_token_create(match));
-                sol_list_add_obj(current_list, (SolObject) frozen);
-                sol_obj_release((SolObject) frozen);
-                sol_list_add_obj(list, (SolObject) current_list);
-            }
-            if (final == '.') {
-                sol_list_add_obj(list, (SolObject) sol_token_create("get"));
-            } else {
-                sol_list_add_obj(list, (SolObject) sol_token_create("@get"));
-            }
-            result_object = (SolObject) list;
-        } else {
-            if (!result_object) {
-                result_object = (SolObject) sol_token_create(match);
-            } else {
-                SolList frozen = (SolList) sol_obj_retain((SolObject) sol_list_create(false));
-                sol_list_add_obj(frozen, (SolObject) sol_token_create("freeze"));
-                sol_list_add_obj(frozen, (SolObject) sol_token_create(match));
-                sol_list_add_obj((SolList) result_object, (SolObject) frozen);
-                sol_obj_release((SolObject) frozen);
-            }
-            pcre_free(match);
+    sol_obj_release(object);
+}
+
+static void check_complete(solc_context* ctx) {
+    if (ctx->modifiers.expect_body) {
+        parse_error(ctx, ctx->end, "function modifier found before frozen list");
+        return;
+    }
+    if (ctx->frame_count == 0) return;
+    // report the innermost frame left open
+    solc_frame* frame = &ctx->frames[ctx->frame_count - 1];
+    const char* open = ctx->begin + frame->open;
+    switch (frame->kind) {
+        case SOLC_FRAME_OBJECT_LITERAL:
+            parse_error(ctx, open, "encountered unclosed object literal");
             break;
-        }
-        pcre_free(match);
+        case SOLC_FRAME_FUNCTION_LITERAL:
+            parse_error(ctx, open, "encountered unclosed function literal");
+            break;
+        case SOLC_FRAME_FREEZE:
+            parse_error(ctx, open, "expected an object after ':'");
+            break;
+        default:
+            parse_error(ctx, open, "encountered unclosed list");
+    }
+}
+
+static SolList object_literal_list(solc_context* ctx) {
+    SolList raw_list = (SolList) sol_obj_retain((SolObject) sol_list_create(true));
+    sol_list_add_obj(raw_list, (SolObject) solc_atom(ctx, SOLC_ATOM_OBJECT));
+    sol_list_add_obj(raw_list, (SolObject) solc_atom(ctx, SOLC_ATOM_CREATE));
+    return raw_list;
+}
+
+static void release_modifiers(solc_modifiers* modifiers) {
+    if (modifiers->params) sol_obj_release((SolObject) modifiers->params);
+    if (modifiers->parent) sol_obj_release((SolObject) modifiers->parent);
+    *modifiers = (solc_modifiers) { 0 };
+}
+
+static SolObject read_token(solc_context* ctx) {
+    // find the end of the token
+    const char* start = ctx->src;
+    ctx->src = solc_find_delimiter(ctx->src, ctx->end);
+    if (ctx->src == start) {
+        parse_error(ctx, start, "unexpected '%c'", *start);
+        return NULL;
     }
     
-    free(ovector);
-    free(result);
+    // handle object '.'/'@' getter shorthand
+    SolObject result_object = split_getter_chain(ctx, start, ctx->src - start);
+    if (result_object == NULL) return NULL;
+    
     return sol_obj_retain(result_object);
 }
 
-SolString read_string() {
+static SolString read_string(solc_context* ctx) {
     // advance past open quote
-    src++;
-    char* buff = malloc(256);
-    size_t buff_size = 256;
+    const char* open = ctx->src++;
+    char* buff = solc_context_scratch(ctx, SOLC_SCRATCH_SIZE);
+    if (buff == NULL) return NULL;
+    size_t buff_size = ctx->scratch_size;
     char* buff_pos = buff;
     bool escaped = false;
-    while (true) {
-        if (buff_pos - buff == buff_size) {
-            buff = realloc(buff, buff_size *= 2);
-            buff_pos = buff + buff_size/2;
+    while (ctx->src < ctx->end) {
+        if ((size_t) (buff_pos - buff) == buff_size) {
+            buff = solc_context_scratch(ctx, buff_size * 2);
+            if (buff == NULL) return NULL;
+            buff_pos = buff + buff_size;
+            buff_size = ctx->scratch_size;
         }
         // handle escape sequences
         if (escaped) {
             escaped = false;
-            switch (*src) {
+            switch (*ctx->src) {
                 case 'b':
                     *buff_pos = '\b';
                     break;
@@ -420,42 +523,134 @@ SolString read_string() {
                     *buff_pos = '\\';
                     break;
                 default:
-                    printf("WARNING: Invalid escape sequence encountered: \\%c", *src);
+                    fprintf(stderr, "WARNING: Invalid escape sequence encountered: \\%c\n", *ctx->src);
+                    *buff_pos = *ctx->src;
             }
         } else {
-            switch (*src) {
+            switch (*ctx->src) {
                 case '"': {
-                    size_t result_len = buff_pos - buff;
-                    char* result = memcpy(malloc(result_len + 1), buff, result_len);
-                    result[result_len] = '\0';
-                    free(buff);
-                    src++;
-                    SolString result_str = (SolString) sol_obj_retain((SolObject) sol_string_create(result));
-                    free(result);
-                    return result_str;
+                    if ((size_t) (buff_pos - buff) == buff_size) {
+                        buff = solc_context_scratch(ctx, buff_size + 1);
+                        if (buff == NULL) return NULL;
+                        buff_pos = buff + buff_size;
+                    }
+                    *buff_pos = '\0';
+                    ctx->src++;
+                    return (SolString) sol_obj_retain((SolObject) sol_string_create(buff));
                 }
                 case '\\':
                     escaped = true;
-                    src++;
+                    ctx->src++;
                     continue;
                 default:
-                    *buff_pos = *src;
+                    *buff_pos = *ctx->src;
             }
         }
-        src++;
+        ctx->src++;
         buff_pos++;
     }
+    if (ctx->partial) {
+        // the rest of the string has not been read yet
+        ctx->src = open;
+        return NULL;
+    }
+    parse_error(ctx, open, "encountered unterminated string");
+    return NULL;
 }
 
-SolNumber read_number() {
+static SolNumber read_number(solc_context* ctx) {
     double value = 0;
-    int offset = 0;
-    sscanf(src, "%lf%n", &value, &offset);
-    src += offset;
+    size_t length = solc_scan_number(ctx->src, ctx->end, &value);
+    if (length == 0) {
+        // copy the literal to the scratch buffer so strtod can round it
+        const char* end = ctx->src;
+        for (; end < ctx->end && (isalnum(*end) || *end == '.' || *end == '+' || *end == '-'); end++) {}
+        length = end - ctx->src;
+        char* literal = solc_context_scratch(ctx, length + 1);
+        if (literal == NULL) return NULL;
+        memcpy(literal, ctx->src, length);
+        literal[length] = '\0';
+        char* literal_end;
+        value = strtod(literal, &literal_end);
+        length = literal_end - literal;
+    }
+    ctx->src += length;
     return (SolNumber) sol_obj_retain((SolObject) sol_num_create(value));
 }
 
-bool is_delimiter(char c) {
-    static char* delimiters = "()[]{}";
-    return isspace(c) || strchr(delimiters, c) != NULL;
+static SolObject split_getter_chain(solc_context* ctx, const char* token, size_t len) {
+    // splits a token such as "a.b@c" into nested get/@get lists, one segment
+    // at a time, interning each segment directly from the source bytes; a
+    // segment that cannot be interned fails the whole token
+    SolObject result_object = NULL;
+    size_t pos = 0;
+    while (pos < len) {
+        // find the segment start: an optional separator followed by a name
+        if (solc_char_is(token[pos], SOLC_CHAR_GETTER) && (pos + 1 >= len || solc_char_is(token[pos + 1], SOLC_CHAR_GETTER))) {
+            pos++;
+            continue;
+        }
+        const char* match = token + pos;
+        size_t end = solc_char_is(token[pos], SOLC_CHAR_GETTER) ? pos + 1 : pos;
+        while (end < len && !solc_char_is(token[end], SOLC_CHAR_GETTER)) {
+            end++;
+        }
+        // consume trailing separators; the last one selects get/@get
+        bool chained = false;
+        while (end < len && solc_char_is(token[end], SOLC_CHAR_GETTER)) {
+            end++;
+            chained = true;
+        }
+        if (chained) {
+            char final = token[end - 1];
+            size_t match_len = end - 1 - pos;
+            SolToken segment = solc_intern(ctx, match, match_len);
+            if (segment == NULL) return NULL;
+            SolList list = sol_list_create(true);
+            if (!result_object) {
+                sol_list_add_obj(list, (SolObject) segment);
+            } else {
+                SolList current_list = (SolList) result_object;
+                SolList frozen = (SolList) sol_obj_retain((SolObject) sol_list_create(false));
+                sol_list_add_obj(frozen, (SolObject) solc_atom(ctx, SOLC_ATOM_FREEZE));
+                sol_list_add_obj(frozen, (SolObject) segment);
+                sol_list_add_obj(current_list, (SolObject) frozen);
+                sol_obj_release((SolObject) frozen);
+                sol_list_add_obj(list, (SolObject) current_list);
+            }
+            if (final == '.') {
+                sol_list_add_obj(list, (SolObject) solc_atom(ctx, SOLC_ATOM_GET));
+            } else {
+                sol_list_add_obj(list, (SolObject) solc_atom(ctx, SOLC_ATOM_OBJECT_GET));
+            }
+            result_object = (SolObject) list;
+            pos = end;
+        } else {
+            SolToken segment = solc_intern(ctx, match, end - pos);
+            if (segment == NULL) return NULL;
+            if (!result_object) {
+                result_object = (SolObject) segment;
+            } else {
+                SolList frozen = (SolList) sol_obj_retain((SolObject) sol_list_create(false));
+                sol_list_add_obj(frozen, (SolObject) solc_atom(ctx, SOLC_ATOM_FREEZE));
+                sol_list_add_obj(frozen, (SolObject) segment);
+                sol_list_add_obj((SolList) result_object, (SolObject) frozen);
+                sol_obj_release((SolObject) frozen);
+            }
+            break;
+        }
+    }
+    if (!result_object) {
+        // tokens made up only of separators are kept as-is
+        result_object = (SolObject) solc_intern(ctx, token, len);
+    }
+    return result_object;
+}
+
+static void collect_form(SolObject form, void* data) {
+    sol_list_add_obj((SolList) data, form);
+}
+
+static char peek(solc_context* ctx, size_t offset) {
+    return offset < (size_t) (ctx->end - ctx->src) ? ctx->src[offset] : '\0';
 }
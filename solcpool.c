@@ -0,0 +1,118 @@
+#include "solcpool.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+
+// the opcode a constant is written inline with
+#define SOLC_CONSTANT_TOKEN 0x2
+
+#define SOLC_POOL_MIN_CAPACITY 64
+
+static solc_table* pool_table(solc_pool* pool, unsigned char kind);
+static size_t varint_size(size_t value);
+static int compare_constants(const void* a, const void* b);
+
+void solc_pool_init(solc_pool* pool) {
+    solc_table_init(&pool->tokens);
+    solc_table_init(&pool->strings);
+    pool->constants = NULL;
+    pool->constant_count = pool->constant_capacity = 0;
+    pool->entries = NULL;
+    pool->count = 0;
+}
+
+void solc_pool_destroy(solc_pool* pool) {
+    solc_table_destroy(&pool->tokens);
+    solc_table_destroy(&pool->strings);
+    free(pool->constants);
+    free(pool->entries);
+    solc_pool_init(pool);
+}
+
+void solc_pool_clear(solc_pool* pool) {
+    solc_table_clear(&pool->tokens);
+    solc_table_clear(&pool->strings);
+    pool->constant_count = 0;
+    pool->count = 0;
+}
+
+bool solc_pool_add(solc_pool* pool, unsigned char kind, const char* bytes, size_t length) {
+    // table values hold the constant's position in constants plus one, since
+    // the array moves as it grows
+    solc_table* table = pool_table(pool, kind);
+    uint64_t hash = solc_hash(bytes, length);
+    solc_table_entry* entry = solc_table_lookup(table, bytes, length, hash);
+    if (entry == NULL) {
+        if (pool->constant_count == pool->constant_capacity) {
+            size_t capacity = pool->constant_capacity ? pool->constant_capacity * 2 : SOLC_POOL_MIN_CAPACITY;
+            solc_constant* constants = realloc(pool->constants, capacity * sizeof(*constants));
+            if (constants == NULL) return false;
+            pool->constants = constants;
+            pool->constant_capacity = capacity;
+        }
+        entry = solc_table_insert(table, bytes, length, hash);
+        if (entry == NULL) return false;
+        pool->constants[pool->constant_count] = (solc_constant) {
+            .kind = kind, .bytes = bytes, .length = length,
+            .order = pool->constant_count, .index = SOLC_CONSTANT_INLINE
+        };
+        entry->value = (void*) (uintptr_t) ++pool->constant_count;
+    }
+    pool->constants[(uintptr_t) entry->value - 1].count++;
+    return true;
+}
+
+bool solc_pool_build(solc_pool* pool) {
+    // gather every constant used more than once, most frequent first
+    size_t candidates = 0;
+    free(pool->entries);
+    pool->entries = malloc((pool->constant_count + 1) * sizeof(*pool->entries));
+    if (pool->entries == NULL) return false;
+    for (size_t i = 0; i < pool->constant_count; i++) {
+        if (pool->constants[i].count > 1) pool->entries[candidates++] = &pool->constants[i];
+    }
+    qsort(pool->entries, candidates, sizeof(*pool->entries), compare_constants);
+    
+    // a constant is pooled when its pool entry plus a reference per use is
+    // smaller than writing it inline each time; the length prefix is counted
+    // as one byte either way
+    pool->count = 0;
+    for (size_t i = 0; i < candidates; i++) {
+        solc_constant* constant = pool->entries[i];
+        size_t inline_size = 2 + constant->length;
+        size_t reference_size = 1 + varint_size(pool->count);
+        if ((constant->count - 1) * inline_size > constant->count * reference_size) {
+            constant->index = pool->count;
+            pool->entries[pool->count++] = constant;
+        }
+    }
+    return true;
+}
+
+solc_constant* solc_pool_find(solc_pool* pool, unsigned char kind, const char* bytes, size_t length) {
+    solc_table_entry* entry = solc_table_lookup(pool_table(pool, kind), bytes, length, solc_hash(bytes, length));
+    if (entry == NULL) return NULL;
+    solc_constant* constant = &pool->constants[(uintptr_t) entry->value - 1];
+    return constant->index == SOLC_CONSTANT_INLINE ? NULL : constant;
+}
+
+static solc_table* pool_table(solc_pool* pool, unsigned char kind) {
+    return kind == SOLC_CONSTANT_TOKEN ? &pool->tokens : &pool->strings;
+}
+
+static size_t varint_size(size_t value) {
+    size_t size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        size++;
+    }
+    return size;
+}
+
+static int compare_constants(const void* a, const void* b) {
+    const solc_constant* first = *(solc_constant* const*) a;
+    const solc_constant* second = *(solc_constant* const*) b;
+    if (first->count != second->count) return first->count > second->count ? -1 : 1;
+    // ties keep the order of first appearance so output is deterministic
+    return first->order < second->order ? -1 : first->order > second->order;
+}
@@ -0,0 +1,50 @@
+/* 
+ * File:   solcpool.h
+ *
+ * Created on October 16, 2026
+ */
+
+#ifndef SOLCPOOL_H
+#define	SOLCPOOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "solctable.h"
+
+/*
+ * Collects the tokens and strings of a program with their number of
+ * occurrences, then picks those worth storing once in a constant pool and
+ * orders them by frequency so the most used get the shortest indices.
+ */
+typedef struct solc_constant {
+    unsigned char kind;
+    const char* bytes;
+    size_t length;
+    size_t count;
+    size_t order;
+    // position in the pool, or SOLC_CONSTANT_INLINE
+    size_t index;
+} solc_constant;
+
+#define SOLC_CONSTANT_INLINE ((size_t) -1)
+
+typedef struct solc_pool {
+    // every distinct constant, found through the table for its kind
+    solc_table tokens;
+    solc_table strings;
+    solc_constant* constants;
+    size_t constant_count;
+    size_t constant_capacity;
+    // the pooled constants in index order
+    solc_constant** entries;
+    size_t count;
+} solc_pool;
+
+void solc_pool_init(solc_pool* pool);
+void solc_pool_destroy(solc_pool* pool);
+void solc_pool_clear(solc_pool* pool);
+bool solc_pool_add(solc_pool* pool, unsigned char kind, const char* bytes, size_t length);
+bool solc_pool_build(solc_pool* pool);
+solc_constant* solc_pool_find(solc_pool* pool, unsigned char kind, const char* bytes, size_t length);
+
+#endif	/* SOLCPOOL_H */
@@ -0,0 +1,187 @@
+#include "solcshare.h"
+#include "solctable.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SOLC_SHARE_MIN_CAPACITY 64
+
+static bool hash_object(solc_share* share, SolObject obj, uint64_t* hash);
+static bool objects_equal(SolObject a, SolObject b);
+static bool share_insert(solc_share* share, size_t node);
+static bool bucket_used(const solc_share* share, size_t i);
+static uint64_t mix(uint64_t hash, uint64_t value);
+
+void solc_share_init(solc_share* share) {
+    share->nodes = NULL;
+    share->node_count = share->node_capacity = 0;
+    share->cursor = 0;
+    share->buckets = NULL;
+    share->bucket_capacity = 0;
+    share->generation = 0;
+    share->written = 0;
+}
+
+void solc_share_destroy(solc_share* share) {
+    free(share->nodes);
+    free(share->buckets);
+    solc_share_init(share);
+}
+
+bool solc_share_begin(solc_share* share, SolObject form) {
+    share->node_count = 0;
+    share->cursor = 0;
+    share->written = 0;
+    if (++share->generation == 0) {
+        // once the counter wraps, stale buckets could match again
+        if (share->buckets) {
+            memset(share->buckets, 0, share->bucket_capacity * sizeof(*share->buckets));
+        }
+        share->generation = 1;
+    }
+    uint64_t hash;
+    return hash_object(share, form, &hash);
+}
+
+bool solc_share_visit(solc_share* share, SolList list, size_t* id) {
+    // lists are visited in the order they were hashed, less any subtrees
+    // that were replaced by a reference
+    solc_share_node* node = &share->nodes[share->cursor];
+    if (share->bucket_capacity) {
+        size_t mask = share->bucket_capacity - 1;
+        for (size_t i = node->hash & mask; bucket_used(share, i); i = (i + 1) & mask) {
+            solc_share_node* match = &share->nodes[share->buckets[i].node - 1];
+            if (match->hash == node->hash && match->size == node->size
+                    && objects_equal((SolObject) match->list, (SolObject) list)) {
+                share->cursor += node->size;
+                *id = match->id;
+                return true;
+            }
+        }
+    }
+    node->id = share->written++;
+    share->cursor++;
+    *id = SOLC_SHARE_NEW;
+    return share_insert(share, node - share->nodes);
+}
+
+static bool hash_object(solc_share* share, SolObject obj, uint64_t* hash) {
+    switch (obj->type_id) {
+        case TYPE_SOL_LIST: {
+            SolList list = (SolList) obj;
+            if (share->node_count == share->node_capacity) {
+                size_t capacity = share->node_capacity ? share->node_capacity * 2 : SOLC_SHARE_MIN_CAPACITY;
+                solc_share_node* nodes = realloc(share->nodes, capacity * sizeof(*nodes));
+                if (nodes == NULL) return false;
+                share->nodes = nodes;
+                share->node_capacity = capacity;
+            }
+            // the node is claimed before the items so the order is pre-order
+            size_t node = share->node_count++;
+            uint64_t value = mix(mix(TYPE_SOL_LIST, list->object_mode), list->length);
+            SOL_LIST_ITR(list, current, i) {
+                uint64_t item;
+                if (!hash_object(share, current->value, &item)) return false;
+                value = mix(value, item);
+            }
+            share->nodes[node] = (solc_share_node) {
+                .list = list, .hash = value, .size = share->node_count - node, .id = SOLC_SHARE_NEW
+            };
+            *hash = value;
+            return true;
+        }
+        case TYPE_SOL_TOKEN: {
+            const char* identifier = ((SolToken) obj)->identifier;
+            *hash = mix(TYPE_SOL_TOKEN, solc_hash(identifier, strlen(identifier)));
+            return true;
+        }
+        case TYPE_SOL_DATATYPE:
+            switch (((SolDatatype) obj)->type_id) {
+                case DATA_TYPE_NUM: {
+                    uint64_t bits;
+                    memcpy(&bits, &((SolNumber) obj)->value, sizeof(bits));
+                    *hash = mix(DATA_TYPE_NUM, bits);
+                    return true;
+                }
+                case DATA_TYPE_STR: {
+                    const char* value = ((SolString) obj)->value;
+                    *hash = mix(DATA_TYPE_STR, solc_hash(value, strlen(value)));
+                    return true;
+                }
+                default:
+                    break;
+            }
+            // fall through
+        default:
+            // the emitter rejects these; they just never match anything
+            *hash = (uintptr_t) obj;
+            return true;
+    }
+}
+
+static bool objects_equal(SolObject a, SolObject b) {
+    if (a == b) return true;
+    if (a->type_id != b->type_id) return false;
+    switch (a->type_id) {
+        case TYPE_SOL_LIST: {
+            SolList list_a = (SolList) a, list_b = (SolList) b;
+            if (list_a->object_mode != list_b->object_mode || list_a->length != list_b->length) return false;
+            SolListNode* current_b = list_b->first;
+            SOL_LIST_ITR(list_a, current_a, i) {
+                if (!objects_equal(current_a->value, current_b->value)) return false;
+                current_b = current_b->next;
+            }
+            return true;
+        }
+        case TYPE_SOL_TOKEN:
+            return !strcmp(((SolToken) a)->identifier, ((SolToken) b)->identifier);
+        case TYPE_SOL_DATATYPE:
+            if (((SolDatatype) a)->type_id != ((SolDatatype) b)->type_id) return false;
+            switch (((SolDatatype) a)->type_id) {
+                case DATA_TYPE_NUM:
+                    // compared bit for bit, so 0 and -0 stay apart
+                    return !memcmp(&((SolNumber) a)->value, &((SolNumber) b)->value, sizeof(double));
+                case DATA_TYPE_STR:
+                    return !strcmp(((SolString) a)->value, ((SolString) b)->value);
+                default:
+                    return false;
+            }
+        default:
+            return false;
+    }
+}
+
+static bool share_insert(solc_share* share, size_t node) {
+    // keep the table at most half full
+    if ((share->written + 1) * 2 > share->bucket_capacity) {
+        size_t capacity = share->bucket_capacity ? share->bucket_capacity * 2 : SOLC_SHARE_MIN_CAPACITY;
+        solc_share_bucket* buckets = calloc(capacity, sizeof(*buckets));
+        if (buckets == NULL) return false;
+        // only the current form's buckets move; the new table starts clean
+        for (size_t i = 0; i < share->bucket_capacity; i++) {
+            if (!bucket_used(share, i)) continue;
+            size_t j = share->nodes[share->buckets[i].node - 1].hash & (capacity - 1);
+            while (buckets[j].generation == share->generation) j = (j + 1) & (capacity - 1);
+            buckets[j] = share->buckets[i];
+        }
+        free(share->buckets);
+        share->buckets = buckets;
+        share->bucket_capacity = capacity;
+    }
+    size_t mask = share->bucket_capacity - 1;
+    size_t i = share->nodes[node].hash & mask;
+    while (bucket_used(share, i)) i = (i + 1) & mask;
+    share->buckets[i] = (solc_share_bucket) { .node = node + 1, .generation = share->generation };
+    return true;
+}
+
+static bool bucket_used(const solc_share* share, size_t i) {
+    return share->buckets[i].generation == share->generation;
+}
+
+static uint64_t mix(uint64_t hash, uint64_t value) {
+    // folds value into hash with a 64-bit multiply and xorshift
+    hash ^= value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+    hash *= 0xff51afd7ed558ccdULL;
+    return hash ^ (hash >> 33);
+}
@@ -0,0 +1,62 @@
+/* 
+ * File:   solcshare.h
+ *
+ * Created on October 16, 2026
+ */
+
+#ifndef SOLCSHARE_H
+#define	SOLCSHARE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sol/runtime.h>
+
+/*
+ * Finds lists that repeat an earlier list of the same top-level form so
+ * they can be written as a reference to it. Every list in the form is
+ * hashed up front, in the order the emitter will reach them; lists that are
+ * written out get ids in that same order, and a list equal to one of them
+ * is replaced, along with everything inside it, by that id.
+ */
+typedef struct solc_share_node {
+    SolList list;
+    uint64_t hash;
+    // lists in the subtree, this one included
+    size_t size;
+    // id once written, or SOLC_SHARE_NEW
+    size_t id;
+} solc_share_node;
+
+#define SOLC_SHARE_NEW ((size_t) -1)
+
+/*
+ * A bucket belongs to the form whose generation it carries; buckets left
+ * over from earlier forms count as empty, so starting a form never has to
+ * clear the table.
+ */
+typedef struct solc_share_bucket {
+    // node index plus one
+    size_t node;
+    size_t generation;
+} solc_share_bucket;
+
+typedef struct solc_share {
+    // every list of the form in pre-order, and the next to be visited
+    solc_share_node* nodes;
+    size_t node_count;
+    size_t node_capacity;
+    size_t cursor;
+    // written nodes by hash
+    solc_share_bucket* buckets;
+    size_t bucket_capacity;
+    size_t generation;
+    size_t written;
+} solc_share;
+
+void solc_share_init(solc_share* share);
+void solc_share_destroy(solc_share* share);
+bool solc_share_begin(solc_share* share, SolObject form);
+bool solc_share_visit(solc_share* share, SolList list, size_t* id);
+
+#endif	/* SOLCSHARE_H */
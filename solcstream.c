@@ -0,0 +1,96 @@
+#include "solc.h"
+#include "solccontext.h"
+
+#include <string.h>
+
+#ifndef SOLC_STREAM_CHUNK_SIZE
+#define SOLC_STREAM_CHUNK_SIZE (64 * 1024)
+#endif
+
+static void emit_form(SolObject form, void* data);
+
+void solc_parse_stream(FILE* source, solc_form_callback callback, void* data) {
+    solc_context* ctx = solc_context_create();
+    solc_parse_stream_ctx(ctx, source, callback, data);
+    solc_exit_on_error(ctx);
+    solc_context_destroy(ctx);
+}
+
+bool solc_parse_stream_ctx(solc_context* ctx, FILE* source, solc_form_callback callback, void* data) {
+    solc_begin(ctx);
+    solc_parse_start(ctx, callback, data);
+    size_t capacity = SOLC_STREAM_CHUNK_SIZE;
+    char* buffer = malloc(capacity);
+    size_t length = 0, parsed = 0;
+    while (true) {
+        // top up the buffer, growing it only when a single form fills it
+        if (length == capacity) {
+            char* grown = realloc(buffer, capacity *= 2);
+            if (grown == NULL) free(buffer);
+            buffer = grown;
+        }
+        if (buffer == NULL) {
+            solc_parse_unwind(ctx);
+            solc_error(ctx, "parsing source", NULL, "out of memory");
+            return false;
+        }
+        size_t count = fread(buffer + length, 1, capacity - length, source);
+        if (count == 0) {
+            if (ferror(source)) {
+                free(buffer);
+                solc_parse_unwind(ctx);
+                solc_error(ctx, "parsing source", NULL, "error while reading file");
+                return false;
+            }
+            break;
+        }
+        length += count;
+        
+        // parse up to the last lexeme that could still be cut off
+        if (!solc_parse_resume(ctx, buffer, parsed, length, true)) {
+            free(buffer);
+            return false;
+        }
+        parsed = ctx->src - buffer;
+        
+        // once no form is open, the parsed text is no longer needed
+        if (ctx->frame_count == 0 && parsed > 0) {
+            solc_advance_position(ctx, buffer + parsed);
+            memmove(buffer, buffer + parsed, length - parsed);
+            length -= parsed;
+            parsed = 0;
+        }
+    }
+    
+    // the end of the input completes whatever remains
+    bool ret = solc_parse_resume(ctx, buffer, parsed, length, false);
+    free(buffer);
+    return ret;
+}
+
+void solc_compile_stream(FILE* source, FILE* output) {
+    solc_context* ctx = solc_context_create();
+    solc_compile_stream_ctx(ctx, source, output);
+    solc_exit_on_error(ctx);
+    solc_context_destroy(ctx);
+}
+
+bool solc_compile_stream_ctx(solc_context* ctx, FILE* source, FILE* output) {
+    // the header is written before parsing starts, so the context has to be
+    // cleared of an earlier failure first
+    solc_begin(ctx);
+    solc_emit_begin(ctx, solc_write_file, output);
+    if (ctx->failed) {
+        solc_emit_end(ctx);
+        return false;
+    }
+    bool parsed = solc_parse_stream_ctx(ctx, source, emit_form, ctx);
+    if (solc_emit_end(ctx) && fflush(output)) {
+        solc_error(ctx, "emitting binary", NULL, "error while writing compiled data");
+    }
+    return !ctx->failed && parsed;
+}
+
+static void emit_form(SolObject form, void* data) {
+    solc_emit_form((solc_context*) data, form);
+}
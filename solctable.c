@@ -0,0 +1,87 @@
+#include "solctable.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SOLC_TABLE_MIN_CAPACITY 64
+
+static solc_table_entry* table_probe(solc_table_entry* entries, size_t capacity, const char* key, size_t length, uint64_t hash);
+static bool table_grow(solc_table* table);
+
+uint64_t solc_hash(const void* data, size_t length) {
+    // 64-bit FNV-1a
+    const unsigned char* bytes = data;
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+void solc_table_init(solc_table* table) {
+    table->entries = NULL;
+    table->capacity = 0;
+    table->count = 0;
+}
+
+void solc_table_destroy(solc_table* table) {
+    free(table->entries);
+    solc_table_init(table);
+}
+
+void solc_table_clear(solc_table* table) {
+    if (table->entries) {
+        memset(table->entries, 0, sizeof(*table->entries) * table->capacity);
+    }
+    table->count = 0;
+}
+
+solc_table_entry* solc_table_lookup(solc_table* table, const char* key, size_t length, uint64_t hash) {
+    if (table->count == 0) return NULL;
+    solc_table_entry* entry = table_probe(table->entries, table->capacity, key, length, hash);
+    return entry->key ? entry : NULL;
+}
+
+solc_table_entry* solc_table_insert(solc_table* table, const char* key, size_t length, uint64_t hash) {
+    // keep the load factor at or below 1/2
+    if ((table->count + 1) * 2 > table->capacity && !table_grow(table)) {
+        return NULL;
+    }
+    solc_table_entry* entry = table_probe(table->entries, table->capacity, key, length, hash);
+    if (entry->key == NULL) {
+        entry->key = key;
+        entry->length = length;
+        entry->hash = hash;
+        entry->value = NULL;
+        table->count++;
+    }
+    return entry;
+}
+
+static solc_table_entry* table_probe(solc_table_entry* entries, size_t capacity, const char* key, size_t length, uint64_t hash) {
+    size_t mask = capacity - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        solc_table_entry* entry = entries + i;
+        if (entry->key == NULL) return entry;
+        if (entry->hash == hash && entry->length == length && !memcmp(entry->key, key, length)) {
+            return entry;
+        }
+    }
+}
+
+static bool table_grow(solc_table* table) {
+    size_t capacity = table->capacity ? table->capacity * 2 : SOLC_TABLE_MIN_CAPACITY;
+    solc_table_entry* entries = calloc(capacity, sizeof(*entries));
+    if (entries == NULL) return false;
+    for (size_t i = 0; i < table->capacity; i++) {
+        solc_table_entry* old = table->entries + i;
+        if (old->key) {
+            *table_probe(entries, capacity, old->key, old->length, old->hash) = *old;
+        }
+    }
+    free(table->entries);
+    table->entries = entries;
+    table->capacity = capacity;
+    return true;
+}
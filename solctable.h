@@ -0,0 +1,44 @@
+/* 
+ * File:   solctable.h
+ *
+ * Created on October 16, 2026
+ */
+
+#ifndef SOLCTABLE_H
+#define	SOLCTABLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * An open-addressed hash table keyed by byte strings. The table does not own
+ * its keys; callers must keep them alive for as long as they are stored.
+ */
+typedef struct solc_table_entry {
+    const char* key;
+    size_t length;
+    uint64_t hash;
+    void* value;
+} solc_table_entry;
+
+typedef struct solc_table {
+    solc_table_entry* entries;
+    size_t capacity;
+    size_t count;
+} solc_table;
+
+#define SOLC_TABLE_ITR(table, entry) \
+    for (solc_table_entry* entry = (table)->entries; entry < (table)->entries + (table)->capacity; entry++) \
+        if (entry->key != NULL)
+
+uint64_t solc_hash(const void* data, size_t length);
+
+void solc_table_init(solc_table* table);
+void solc_table_destroy(solc_table* table);
+void solc_table_clear(solc_table* table);
+solc_table_entry* solc_table_lookup(solc_table* table, const char* key, size_t length, uint64_t hash);
+solc_table_entry* solc_table_insert(solc_table* table, const char* key, size_t length, uint64_t hash);
+
+#endif	/* SOLCTABLE_H */
+
@@ -1,55 +1,263 @@
-
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <math.h>
 #include <sys/types.h>
+#include "solgen.h"
 
 #define cprint(...) fprintf(out, __VA_ARGS__)
 
-static unsigned char* src;
-static off_t src_size;
-static FILE* out;
+// bytes per line of the generated array or string literal
+#define SOLC_GENERATE_LINE_BYTES 12
+#define SOLC_GENERATE_LINE_CHARS 64
+
+// the most text one byte can add to the block: a line break and an escape
+#define SOLC_GENERATE_MAX_BYTE_SIZE 16
+
+static const char hex_digits[] = "0123456789ABCDEF";
+
+void cprint_header(FILE* out, solc_generate_style style);
+void cprint_footer(FILE* out, solc_generate_style style);
+void cprint_main(FILE* out, const char* execute);
 
-void cprint_header();
-void cprint_footer();
-void cprint_data();
+static bool flush_block(solc_generator* gen);
+static char* escape_byte(char* p, unsigned char byte);
+
+static bool cprint_form(FILE* out, SolObject form, int n);
+static bool cprint_items(FILE* out, SolList list, size_t depth);
+static bool cprint_value(FILE* out, SolObject obj);
+static void cprint_literal(FILE* out, const char* text);
+static size_t list_depth(SolObject obj);
 
 void solc_generate_c(unsigned char* source, off_t source_size, FILE* output) {
-    src = source;
-    src_size = source_size;
-    out = output;
-    
-    cprint_header();
-    cprint_data();
-    cprint_footer();
+    solc_generator gen;
+    solc_generate_c_begin(&gen, output, SOLC_GENERATE_BYTES);
+    solc_generate_c_write(source, source_size, &gen);
+    solc_generate_c_end(&gen);
+}
+
+void solc_generate_c_begin(solc_generator* gen, FILE* output, solc_generate_style style) {
+    gen->out = output;
+    gen->style = style;
+    gen->count = 0;
+    gen->length = 0;
+    cprint_header(output, style);
+}
+
+bool solc_generate_c_write(const unsigned char* bytes, size_t size, void* data) {
+    solc_generator* gen = data;
+    for (size_t i = 0; i < size; i++) {
+        if (gen->length > SOLC_GENERATE_BLOCK_SIZE - SOLC_GENERATE_MAX_BYTE_SIZE && !flush_block(gen)) {
+            return false;
+        }
+        char* p = gen->block + gen->length;
+        unsigned char byte = bytes[i];
+        if (gen->style == SOLC_GENERATE_BYTES) {
+            if (gen->count++ % SOLC_GENERATE_LINE_BYTES == 0) {
+                memcpy(p, "\n  ", 3);
+                p += 3;
+            }
+            p[0] = '0';
+            p[1] = 'x';
+            p[2] = hex_digits[byte >> 4];
+            p[3] = hex_digits[byte & 0xF];
+            p[4] = ',';
+            p += 5;
+        } else {
+            if (gen->count++ % SOLC_GENERATE_LINE_CHARS == 0) {
+                // adjacent literals are joined by the compiler
+                if (gen->count > 1) *p++ = '"';
+                memcpy(p, "\n  \"", 4);
+                p += 4;
+            }
+            p = escape_byte(p, byte);
+        }
+        gen->length = p - gen->block;
+    }
+    return true;
+}
+
+bool solc_generate_c_end(solc_generator* gen) {
+    FILE* out = gen->out;
+    if (!flush_block(gen)) return false;
+    if (gen->style == SOLC_GENERATE_STRING) {
+        fputs(gen->count ? "\"" : "\n  \"\"", out);
+    }
+    fputc('\n', out);
+    cprint_footer(out, gen->style);
+    return !ferror(out);
 }
 
-void cprint_header() {
+bool solc_generate_c_main(FILE* out) {
     cprint("#include <sol/runtime.h>\n\n");
-    cprint("unsigned char data[] = {");
+    cprint("extern unsigned char data[];\n\n");
+    cprint_main(out, "sol_runtime_execute(data);");
+    return !ferror(out);
 }
 
-void cprint_footer() {
+bool solc_generate_c_program(SolList program, FILE* out) {
+    cprint("#include <math.h>\n");
+    cprint("#include <sol/runtime.h>\n\n");
+    SOL_LIST_ITR(program, current, i) {
+        if (!cprint_form(out, current->value, i)) return false;
+    }
+    
+    // forms are built and evaluated one at a time, in order
+    cprint("static SolObject (*const forms[])(void) = {\n");
+    for (int i = 0; i < program->length; i++) {
+        cprint("    form_%d,\n", i);
+    }
+    cprint("    NULL\n");
     cprint("};\n\n");
+    cprint("static void run(void) {\n");
+    cprint("    for (int i = 0; forms[i]; i++) {\n");
+    cprint("        SolObject form = sol_obj_retain(forms[i]());\n");
+    cprint("        sol_obj_release(sol_obj_evaluate(form));\n");
+    cprint("        sol_obj_release(form);\n");
+    cprint("    }\n");
+    cprint("}\n\n");
+    cprint_main(out, "run();");
+    return !ferror(out);
+}
+
+static bool flush_block(solc_generator* gen) {
+    if (gen->length && fwrite(gen->block, gen->length, 1, gen->out) != 1) return false;
+    gen->length = 0;
+    return true;
+}
+
+static char* escape_byte(char* p, unsigned char byte) {
+    // escapes are always three octal digits, so a digit after one cannot be
+    // taken as part of it; '?' is escaped to rule out trigraphs
+    if (byte >= 0x20 && byte < 0x7F && byte != '"' && byte != '\\' && byte != '?') {
+        *p++ = byte;
+    } else {
+        p[0] = '\\';
+        p[1] = '0' + (byte >> 6);
+        p[2] = '0' + ((byte >> 3) & 7);
+        p[3] = '0' + (byte & 7);
+        p += 4;
+    }
+    return p;
+}
+
+static bool cprint_form(FILE* out, SolObject form, int n) {
+    cprint("static SolObject form_%d(void) {\n", n);
+    if (form->type_id != TYPE_SOL_LIST) {
+        cprint("    return ");
+        if (!cprint_value(out, form)) return false;
+        cprint(";\n}\n\n");
+        return true;
+    }
+    // each nesting level of the form has its own slot for the list being
+    // filled, so construction is straight-line code
+    cprint("    SolList lists[%zu];\n", list_depth(form));
+    cprint("    lists[0] = sol_list_create(%s);\n", ((SolList) form)->object_mode ? "true" : "false");
+    if (!cprint_items(out, (SolList) form, 0)) return false;
+    cprint("    return (SolObject) lists[0];\n");
+    cprint("}\n\n");
+    return true;
+}
+
+static bool cprint_items(FILE* out, SolList list, size_t depth) {
+    SOL_LIST_ITR(list, current, i) {
+        SolObject item = current->value;
+        if (item->type_id == TYPE_SOL_LIST) {
+            cprint("    lists[%zu] = sol_list_create(%s);\n", depth + 1, ((SolList) item)->object_mode ? "true" : "false");
+            cprint("    sol_list_add_obj(lists[%zu], (SolObject) lists[%zu]);\n", depth, depth + 1);
+            if (!cprint_items(out, (SolList) item, depth + 1)) return false;
+        } else {
+            cprint("    sol_list_add_obj(lists[%zu], ", depth);
+            if (!cprint_value(out, item)) return false;
+            cprint(");\n");
+        }
+    }
+    return true;
+}
+
+static bool cprint_value(FILE* out, SolObject obj) {
+    if (obj == nil) {
+        cprint("nil");
+        return true;
+    }
+    switch (obj->type_id) {
+        case TYPE_SOL_TOKEN: {
+            // the binary format turns these tokens into booleans
+            const char* identifier = ((SolToken) obj)->identifier;
+            if (!strcmp(identifier, "true") || !strcmp(identifier, "false")) {
+                cprint("(SolObject) sol_bool_create(%s)", identifier);
+            } else {
+                cprint("(SolObject) sol_token_create(");
+                cprint_literal(out, identifier);
+                cprint(")");
+            }
+            return true;
+        }
+        case TYPE_SOL_DATATYPE:
+            switch (((SolDatatype) obj)->type_id) {
+                case DATA_TYPE_NUM: {
+                    // hexadecimal floating constants are exact
+                    double value = ((SolNumber) obj)->value;
+                    if (isnan(value)) {
+                        cprint("(SolObject) sol_num_create(NAN)");
+                    } else if (isinf(value)) {
+                        cprint("(SolObject) sol_num_create(%sINFINITY)", value < 0 ? "-" : "");
+                    } else {
+                        cprint("(SolObject) sol_num_create(%a)", value);
+                    }
+                    return true;
+                }
+                case DATA_TYPE_STR:
+                    cprint("(SolObject) sol_string_create(");
+                    cprint_literal(out, ((SolString) obj)->value);
+                    cprint(")");
+                    return true;
+                default:
+                    return false;
+            }
+        default:
+            return false;
+    }
+}
+
+static void cprint_literal(FILE* out, const char* text) {
+    char escaped[4];
+    fputc('"', out);
+    for (const char* c = text; *c; c++) {
+        fwrite(escaped, escape_byte(escaped, *c) - escaped, 1, out);
+    }
+    fputc('"', out);
+}
+
+static size_t list_depth(SolObject obj) {
+    if (obj->type_id != TYPE_SOL_LIST) return 0;
+    size_t depth = 0;
+    SOL_LIST_ITR((SolList) obj, current, i) {
+        size_t item_depth = list_depth(current->value);
+        if (item_depth > depth) depth = item_depth;
+    }
+    return depth + 1;
+}
+
+void cprint_header(FILE* out, solc_generate_style style) {
+    cprint("#include <sol/runtime.h>\n\n");
+    cprint(style == SOLC_GENERATE_STRING ? "unsigned char data[] =" : "unsigned char data[] = {");
+}
+
+void cprint_footer(FILE* out, solc_generate_style style) {
+    cprint(style == SOLC_GENERATE_STRING ? ";\n\n" : "};\n\n");
+    cprint_main(out, "sol_runtime_execute(data);");
+}
+
+void cprint_main(FILE* out, const char* execute) {
     cprint("int main(int argc, char** argv) {\n");
     cprint("    sol_runtime_init();\n");
     cprint("    SolList arguments = (SolList) sol_obj_retain((SolObject) sol_list_create(false));");
     cprint("    for (int i = 0; i < argc; i++) { sol_list_add_obj(arguments, (SolObject) sol_string_create(argv[i])); }");
     cprint("    sol_token_register(\"arguments\", (SolObject) arguments);");
-    cprint("    sol_runtime_execute(data);\n");
+    cprint("    %s\n", execute);
     cprint("    sol_obj_release((SolObject) arguments);");
     cprint("    sol_runtime_destroy();\n");
     cprint("    return 0;\n");
     cprint("}\n");
 }
-
-void cprint_data() {
-    int ch;
-    int i = 0;
-    for (; (ch = *src), --src_size; src++) {
-        if (i++ % 12 == 0)
-            fputs("\n  ", out);
-        fprintf(out, "0x%02X,", ch);
-    }
-    fputc('\n', out);
-}
@@ -8,7 +8,54 @@
 #ifndef SOLGEN_H
 #define	SOLGEN_H
 
+#include <stdio.h>
+#include <stdbool.h>
+#include <sys/types.h>
+#include <sol/runtime.h>
+
 void solc_generate_c(unsigned char* source, off_t source_size, FILE* out);
 
+#define SOLC_GENERATE_BLOCK_SIZE (16 * 1024)
+
+/*
+ * The binary is embedded either as an array initializer of hex bytes or as
+ * a string literal, which compilers handle much faster for large programs.
+ */
+typedef enum {
+    SOLC_GENERATE_BYTES,
+    SOLC_GENERATE_STRING
+} solc_generate_style;
+
+/*
+ * Generates the same C source incrementally, so that it can be used as an
+ * emit sink: pass solc_generate_c_write as the write callback with the
+ * generator as its data. Output is formatted into block and written out a
+ * block at a time.
+ */
+typedef struct solc_generator {
+    FILE* out;
+    solc_generate_style style;
+    size_t count;
+    char block[SOLC_GENERATE_BLOCK_SIZE];
+    size_t length;
+} solc_generator;
+
+void solc_generate_c_begin(solc_generator* gen, FILE* out, solc_generate_style style);
+bool solc_generate_c_write(const unsigned char* bytes, size_t size, void* data);
+bool solc_generate_c_end(solc_generator* gen);
+
+/*
+ * Writes only the main function, referring to the binary as an external
+ * symbol named data, for linking against an object from solc_elf_begin.
+ */
+bool solc_generate_c_main(FILE* out);
+
+/*
+ * Generates C that builds each top-level form of program with libsol calls
+ * and evaluates it, in place of embedding the binary. Returns false if the
+ * program holds an object that has no literal form.
+ */
+bool solc_generate_c_program(SolList program, FILE* out);
+
 #endif	/* SOLGEN_H */
 
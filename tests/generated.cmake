@@ -0,0 +1,52 @@
+# Checks that a program translated with -a prints exactly what the same
+# program prints when its SOLBIN is executed by the runtime with -e, and
+# that extra options such as -O change neither: both are compared with a
+# plain solc -e run.
+#
+# Run with cmake -P, given SOLC, CC, SOURCE, WORK, INCLUDE, LIBSOL and
+# optionally FLAGS for extra solc options.
+
+file(MAKE_DIRECTORY "${WORK}")
+get_filename_component(name "${SOURCE}" NAME_WE)
+configure_file("${SOURCE}" "${WORK}/${name}.sol" COPYONLY)
+separate_arguments(FLAGS)
+
+execute_process(COMMAND "${SOLC}" -e "${name}.sol"
+    WORKING_DIRECTORY "${WORK}" RESULT_VARIABLE result OUTPUT_VARIABLE expected)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "solc -e failed: ${result}")
+endif()
+
+if(FLAGS)
+    execute_process(COMMAND "${SOLC}" ${FLAGS} -e "${name}.sol"
+        WORKING_DIRECTORY "${WORK}" RESULT_VARIABLE result OUTPUT_VARIABLE actual)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "solc ${FLAGS} -e failed: ${result}")
+    endif()
+    if(NOT actual STREQUAL expected)
+        message(FATAL_ERROR "solc ${FLAGS} -e output differs from solc -e\nexpected:\n${expected}\nactual:\n${actual}")
+    endif()
+endif()
+
+execute_process(COMMAND "${SOLC}" ${FLAGS} -a "${name}.sol"
+    WORKING_DIRECTORY "${WORK}" RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "solc -a failed: ${result}")
+endif()
+
+get_filename_component(libsol_dir "${LIBSOL}" PATH)
+execute_process(COMMAND "${CC}" -std=c99 "-I${INCLUDE}" -o "${name}" "${name}.c" "${LIBSOL}" -lm
+        "-Wl,-rpath,${libsol_dir}"
+    WORKING_DIRECTORY "${WORK}" RESULT_VARIABLE result ERROR_VARIABLE errors)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "the generated program did not compile:\n${errors}")
+endif()
+
+execute_process(COMMAND "${WORK}/${name}"
+    WORKING_DIRECTORY "${WORK}" RESULT_VARIABLE result OUTPUT_VARIABLE actual)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "the generated program failed: ${result}")
+endif()
+if(NOT actual STREQUAL expected)
+    message(FATAL_ERROR "the generated program's output differs from solc -e\nexpected:\n${expected}\nactual:\n${actual}")
+endif()
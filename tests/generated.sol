@@ -0,0 +1,5 @@
+[print "hello" 1 0.5 true false :(a b c) (1 (2 "q") x)]
+[print (+ 1 2) "x\ty" -2.25e10 0.1 1e300 -7]
+[print {one 1 two (2 "two")} ^[print "deferred"] (list true (false))]
+[print "quote \" backslash \\ question ?? end"]
+[print [+ 1 2] (+ 1 2) [* [- 10 4] 0.5] [/ [+ 1 2] 4] :[+ 1 2] ((- 5 1) [- 5 1]) @(* 2 3)]
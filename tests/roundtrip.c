@@ -0,0 +1,214 @@
+/*
+ * File:   roundtrip.c
+ *
+ * Created on October 17, 2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sol/runtime.h>
+#include "solc.h"
+
+/*
+ * Emits programs in every combination of format options, decodes them again
+ * and checks that the forms come back unchanged. The strings and tokens sit
+ * on either side of each boundary of the version 1 length tiers and of each
+ * byte a varint length grows by, and the lists are long enough to need more
+ * than one byte for their length.
+ */
+
+#define HUGE_LENGTH (0xFFFFFFFUL + 1)
+
+static const size_t lengths[] = {
+    0, 1, 15, 16, 127, 128, 4095, 4096, 16383, 16384, (1UL << 20) - 1, 1UL << 20, (1UL << 21) - 1, 1UL << 21
+};
+
+static const size_t list_lengths[] = {
+    0, 127, 128, 300, 16384
+};
+
+static int failures = 0;
+
+static char* make_text(size_t length, char fill);
+static SolList make_program(void);
+static bool objects_equal(SolObject a, SolObject b);
+static void check(const char* what, bool passed);
+static void test_round_trip(SolList program, unsigned int format);
+static void test_huge_string(unsigned int format);
+
+int main(void) {
+    sol_runtime_init();
+    SolList program = make_program();
+    for (unsigned int format = 0; format <= SOLC_FORMAT_ALL; format++) {
+        test_round_trip(program, format);
+    }
+    sol_obj_release((SolObject) program);
+
+    // a length above 2^28 - 1 only fits in a varint; the fixed tiers must
+    // reject it rather than write a corrupt image
+    test_huge_string(0);
+    test_huge_string(SOLC_FORMAT_POOL | SOLC_FORMAT_NUMBERS);
+    test_huge_string(SOLC_FORMAT_VARINT);
+
+    sol_runtime_destroy();
+    if (failures) {
+        fprintf(stderr, "%d checks failed.\n", failures);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+static char* make_text(size_t length, char fill) {
+    char* text = malloc(length + 1);
+    if (text == NULL) {
+        fprintf(stderr, "Out of memory.\n");
+        exit(EXIT_FAILURE);
+    }
+    memset(text, fill, length);
+    text[length] = '\0';
+    return text;
+}
+
+static SolList make_program(void) {
+    SolList program = (SolList) sol_obj_retain((SolObject) sol_list_create(false));
+
+    // one form per boundary length, holding a string and a token of that
+    // length so that both length encodings are covered
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(*lengths); i++) {
+        SolList form = sol_list_create(false);
+        char* text = make_text(lengths[i], 's');
+        sol_list_add_obj(form, (SolObject) sol_string_create(text));
+        free(text);
+        if (lengths[i]) {
+            text = make_text(lengths[i], 't');
+            sol_list_add_obj(form, (SolObject) sol_token_create(text));
+            free(text);
+        }
+        sol_list_add_obj(program, (SolObject) form);
+    }
+
+    // long lists of numbers, strings and repeated sublists, which the pool
+    // and the shared list encoding both get to work on
+    for (size_t i = 0; i < sizeof(list_lengths) / sizeof(*list_lengths); i++) {
+        SolList form = sol_list_create(i % 2);
+        for (size_t j = 0; j < list_lengths[i]; j++) {
+            switch (j % 4) {
+                case 0:
+                    sol_list_add_obj(form, (SolObject) sol_num_create((double) j * (j % 8 ? 1 : -1)));
+                    break;
+                case 1:
+                    sol_list_add_obj(form, (SolObject) sol_num_create(j + 0.5));
+                    break;
+                case 2:
+                    sol_list_add_obj(form, (SolObject) sol_string_create(j % 8 == 2 ? "repeated" : "other"));
+                    break;
+                default: {
+                    SolList inner = sol_list_create(false);
+                    sol_list_add_obj(inner, (SolObject) sol_token_create("inner"));
+                    sol_list_add_obj(inner, (SolObject) sol_num_create(j % 3));
+                    sol_list_add_obj(form, (SolObject) inner);
+                    break;
+                }
+            }
+        }
+        sol_list_add_obj(program, (SolObject) form);
+    }
+    return program;
+}
+
+static bool objects_equal(SolObject a, SolObject b) {
+    if (a->type_id != b->type_id) return false;
+    switch (a->type_id) {
+        case TYPE_SOL_LIST: {
+            SolList list_a = (SolList) a, list_b = (SolList) b;
+            if (list_a->length != list_b->length || list_a->object_mode != list_b->object_mode) return false;
+            SolListNode* node_b = list_b->first;
+            SOL_LIST_ITR(list_a, node_a, i) {
+                if (node_b == NULL || !objects_equal(node_a->value, node_b->value)) return false;
+                node_b = node_b->next;
+            }
+            return node_b == NULL;
+        }
+        case TYPE_SOL_TOKEN:
+            return !strcmp(((SolToken) a)->identifier, ((SolToken) b)->identifier);
+        case TYPE_SOL_DATATYPE: {
+            SolDatatype datatype_a = (SolDatatype) a, datatype_b = (SolDatatype) b;
+            if (datatype_a->type_id != datatype_b->type_id) return false;
+            switch (datatype_a->type_id) {
+                case DATA_TYPE_NUM:
+                    return ((SolNumber) a)->value == ((SolNumber) b)->value;
+                case DATA_TYPE_STR:
+                    return !strcmp(((SolString) a)->value, ((SolString) b)->value);
+                case DATA_TYPE_BOOL:
+                    return ((SolBoolean) a)->value == ((SolBoolean) b)->value;
+                default:
+                    return false;
+            }
+        }
+        default:
+            return a == b;
+    }
+}
+
+static void check(const char* what, bool passed) {
+    if (!passed) {
+        fprintf(stderr, "FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+static void test_round_trip(SolList program, unsigned int format) {
+    char what[64];
+    snprintf(what, sizeof(what), "round trip with format 0x%02x", format);
+    solc_context* ctx = solc_context_create();
+    solc_context_set_format(ctx, format);
+    off_t size;
+    unsigned char* image = solc_emit_ctx(ctx, program, &size);
+    if (image == NULL) {
+        check(what, false);
+        fprintf(stderr, "    emit: %s\n", solc_context_error(ctx)->message);
+        solc_context_destroy(ctx);
+        return;
+    }
+    SolList decoded = solc_decode_ctx(ctx, image, size);
+    if (decoded == NULL) {
+        check(what, false);
+        fprintf(stderr, "    decode: %s\n", solc_context_error(ctx)->message);
+    } else {
+        check(what, objects_equal((SolObject) program, (SolObject) decoded));
+        sol_obj_release((SolObject) decoded);
+    }
+    free(image);
+    solc_context_destroy(ctx);
+}
+
+static void test_huge_string(unsigned int format) {
+    char what[64];
+    snprintf(what, sizeof(what), "string of 2^28 bytes with format 0x%02x", format);
+    SolList program = (SolList) sol_obj_retain((SolObject) sol_list_create(false));
+    SolList form = sol_list_create(false);
+    char* text = make_text(HUGE_LENGTH, 'h');
+    sol_list_add_obj(form, (SolObject) sol_string_create(text));
+    free(text);
+    sol_list_add_obj(program, (SolObject) form);
+
+    solc_context* ctx = solc_context_create();
+    solc_context_set_format(ctx, format);
+    off_t size;
+    unsigned char* image = solc_emit_ctx(ctx, program, &size);
+    if (!(format & SOLC_FORMAT_VARINT)) {
+        check(what, image == NULL && solc_context_error(ctx) != NULL);
+    } else if (image == NULL) {
+        check(what, false);
+        fprintf(stderr, "    emit: %s\n", solc_context_error(ctx)->message);
+    } else {
+        SolList decoded = solc_decode_ctx(ctx, image, size);
+        check(what, decoded != NULL && objects_equal((SolObject) program, (SolObject) decoded));
+        if (decoded) sol_obj_release((SolObject) decoded);
+    }
+    free(image);
+    solc_context_destroy(ctx);
+    sol_obj_release((SolObject) program);
+}